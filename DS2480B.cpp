@@ -0,0 +1,214 @@
+#include <Arduino.h>
+#include "DS2480B.h"
+#include "DS2482_OneWire.h"
+
+// The port must already be opened at 9600 baud, 8N1
+DS2480B::DS2480B(Stream &port) : mPort(port)
+{
+	mCommandMode = 1;
+	mSpeed = DS2480B_SPEED_FLEX;
+	mPulse = 0;
+}
+
+// The first reset after power up calibrates the DS2480B timing and has no reliable
+// reply. The configuration writes echo their value with the low bit cleared.
+bool DS2480B::begin()
+{
+	uint8_t reply[3];
+
+	while (mPort.available())
+		mPort.read();
+	mPort.write(DS2480B_COMMAND_RESET | mSpeed);
+	delay(5);
+	while (mPort.available())
+		mPort.read();
+	mCommandMode = 1;
+	mPulse = 0;
+
+	mPort.write(DS2480B_CONFIG_SLEW);
+	mPort.write(DS2480B_CONFIG_WRITE1);
+	mPort.write(DS2480B_CONFIG_SAMPLE);
+	if (!receive(reply, 3))
+		return false;
+	return reply[0] == (DS2480B_CONFIG_SLEW & ~1) && reply[1] == (DS2480B_CONFIG_WRITE1 & ~1) &&
+		reply[2] == (DS2480B_CONFIG_SAMPLE & ~1);
+}
+
+void DS2480B::commandMode()
+{
+	if (!mCommandMode)
+	{
+		mPort.write(DS2480B_MODE_COMMAND);
+		mCommandMode = 1;
+	}
+}
+
+void DS2480B::dataMode()
+{
+	if (mCommandMode)
+	{
+		mPort.write(DS2480B_MODE_DATA);
+		mCommandMode = 0;
+	}
+}
+
+// In data mode a 0xE3 byte has to be doubled so it is not taken as a mode switch
+void DS2480B::sendData(uint8_t data)
+{
+	mPort.write(data);
+	if (data == DS2480B_MODE_COMMAND)
+		mPort.write(data);
+}
+
+bool DS2480B::receive(uint8_t *buf, uint8_t count)
+{
+	return mPort.readBytes(buf, count) == count;
+}
+
+// Ends a strong pullup pulse. Stop, a dummy pulse and stop again, as in AN192, so the
+// two replies are there whether or not the pulse was still running.
+void DS2480B::endPulse()
+{
+	uint8_t reply[2];
+
+	if (!mPulse)
+		return;
+	commandMode();
+	mPort.write(DS2480B_STOP_PULSE);
+	mPort.write(DS2480B_COMMAND_PULSE | mSpeed);
+	mPort.write(DS2480B_STOP_PULSE);
+	receive(reply, 2);
+	mPulse = 0;
+}
+
+// True while the strong pullup powers a parasite device
+bool DS2480B::pulsing()
+{
+	return mPulse;
+}
+
+// Returns one of DS2480B_RESET_*
+uint8_t DS2480B::reset()
+{
+	uint8_t reply;
+
+	endPulse();
+	commandMode();
+	mPort.write(DS2480B_COMMAND_RESET | mSpeed);
+	if (!receive(&reply, 1))
+		return DS2480B_RESET_NONE;
+	return reply & 0x03;
+}
+
+// With power set the byte goes out as eight bit commands, the last one priming the
+// strong pullup; it stays on until the next bus operation ends it
+uint8_t DS2480B::touchByte(uint8_t data, bool power)
+{
+	uint8_t reply;
+
+	endPulse();
+	if (power)
+	{
+		uint8_t replies[9];
+
+		commandMode();
+		mPort.write(DS2480B_CONFIG_SPUD);
+		for (uint8_t i = 0; i < 8; i++)
+			mPort.write(DS2480B_COMMAND_BIT | mSpeed | ((data >> i) & 1 ? DS2480B_BIT_ONE : 0) |
+				(i == 7 ? DS2480B_BIT_PRIME : 0));
+		if (!receive(replies, 9))
+			return 0xFF;
+		mPulse = 1;
+		reply = 0;
+		for (uint8_t i = 0; i < 8; i++)
+			reply |= (replies[i + 1] & 1) << i;
+		return reply;
+	}
+
+	dataMode();
+	sendData(data);
+	if (!receive(&reply, 1))
+		return 0xFF;
+	return reply;
+}
+
+// Both low bits of the reply hold the sampled line level
+uint8_t DS2480B::touchBit(uint8_t data)
+{
+	uint8_t reply;
+
+	endPulse();
+	commandMode();
+	mPort.write(DS2480B_COMMAND_BIT | mSpeed | (data ? DS2480B_BIT_ONE : 0));
+	if (!receive(&reply, 1))
+		return 1;
+	return reply & 0x01;
+}
+
+// Overdrive Skip ROM at regular speed moves all devices to overdrive; a reset at
+// regular speed brings them back.
+void DS2480B::setOverdrive(bool on)
+{
+	if (on)
+	{
+		mSpeed = DS2480B_SPEED_FLEX;
+		reset();
+		touchByte(WIRE_COMMAND_OVERDRIVE_SKIP);
+		mSpeed = DS2480B_SPEED_OVERDRIVE;
+	}
+	else
+		mSpeed = DS2480B_SPEED_FLEX;
+}
+
+// One search pass using the search accelerator: the 64 chosen directions go out as
+// 16 bytes with direction i in bit 2i+1, and come back with the discrepancy flag of
+// ROM bit i in bit 2i and the ROM bit taken in bit 2i+1. Same return values as
+// OneWire::wireSearch(); rom holds the previous ROM on entry and the new one on exit.
+int8_t DS2480B::search(uint8_t *rom, int8_t lastDiscrepancy, int8_t *lastZero)
+{
+	uint8_t buf[16];
+	uint8_t presence = reset();
+
+	if (presence != DS2480B_RESET_PRESENCE && presence != DS2480B_RESET_ALARM)
+		return -1;
+
+	memset(buf, 0, sizeof(buf));
+	for (uint8_t i = 0; i < 64; i++)
+	{
+		uint8_t direction;
+		if (i < lastDiscrepancy)
+			direction = rom[i >> 3] & (1 << (i & 7));
+		else
+			direction = i == lastDiscrepancy;
+		if (direction)
+			buf[i >> 2] |= 1 << (((i & 3) << 1) + 1);
+	}
+
+	if (touchByte(WIRE_COMMAND_SEARCH) != WIRE_COMMAND_SEARCH)
+		return -1;
+	commandMode();
+	mPort.write(DS2480B_SEARCH_ON | mSpeed);
+	dataMode();
+	for (uint8_t i = 0; i < 16; i++)
+		sendData(buf[i]);
+	if (!receive(buf, 16))
+		return -1;
+	commandMode();
+	mPort.write(DS2480B_SEARCH_OFF | mSpeed);
+
+	*lastZero = -1;
+	memset(rom, 0, 8);
+	for (uint8_t i = 0; i < 64; i++)
+	{
+		uint8_t pair = buf[i >> 2] >> ((i & 3) << 1);
+		if (pair & 2)
+			rom[i >> 3] |= 1 << (i & 7);
+		else if (pair & 1)
+			*lastZero = i;
+	}
+
+	// an empty or collapsed bus reads back as all ones
+	if (OneWire::crc8(rom, 7) != rom[7])
+		return -2;
+	return 1;
+}
@@ -0,0 +1,62 @@
+#ifndef __DS2480B_H__
+#define __DS2480B_H__
+
+#include <Arduino.h>
+
+// DS2480B serial 1-Wire line driver. Commands are bytes sent in command mode;
+// in data mode every byte is a 1-Wire byte and the reply is what was read back.
+
+#define DS2480B_MODE_DATA			0xE1	// switch to data mode
+#define DS2480B_MODE_COMMAND		0xE3	// switch to command mode, doubled to send as data
+
+#define DS2480B_COMMAND_RESET		0xC1
+#define DS2480B_COMMAND_BIT			0x81
+	#define DS2480B_BIT_ONE				0x10
+	#define DS2480B_BIT_PRIME			0x02	// arm the strong pullup after the bit
+#define DS2480B_SEARCH_ON			0xB1
+#define DS2480B_SEARCH_OFF			0xA1
+#define DS2480B_COMMAND_PULSE		0xED	// strong pullup pulse, no prime
+#define DS2480B_STOP_PULSE			0xF1
+
+	#define DS2480B_SPEED_REGULAR		0x00
+	#define DS2480B_SPEED_FLEX			0x04
+	#define DS2480B_SPEED_OVERDRIVE		0x08
+
+// Configuration parameter writes (AN192 values for long lines)
+#define DS2480B_CONFIG_SLEW			0x17	// pulldown slew rate 1.37V/us
+#define DS2480B_CONFIG_WRITE1		0x45	// write-1 low time 10us
+#define DS2480B_CONFIG_SAMPLE		0x5B	// data sample offset 8us
+#define DS2480B_CONFIG_SPUD			0x3F	// strong pullup duration unlimited
+
+// Reset reply, low two bits
+#define DS2480B_RESET_SHORT			0x00
+#define DS2480B_RESET_PRESENCE		0x01
+#define DS2480B_RESET_ALARM			0x02
+#define DS2480B_RESET_NONE			0x03
+
+class DS2480B
+{
+public:
+	DS2480B(Stream &port);
+	bool begin();
+	uint8_t reset();
+	uint8_t touchByte(uint8_t data, bool power = false);
+	uint8_t touchBit(uint8_t data);
+	int8_t search(uint8_t *rom, int8_t lastDiscrepancy, int8_t *lastZero);
+	void setOverdrive(bool on);
+	bool pulsing();
+
+private:
+	void commandMode();
+	void dataMode();
+	void sendData(uint8_t data);
+	bool receive(uint8_t *buf, uint8_t count);
+	void endPulse();
+
+	Stream &mPort;
+	uint8_t mCommandMode;
+	uint8_t mSpeed;
+	uint8_t mPulse;			// strong pullup left on by touchByte(data, true)
+};
+
+#endif
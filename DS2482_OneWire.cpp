@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include "DS2482_OneWire.h"
+#include "DS2480B.h"
 #include <Wire.h>
 
 // Constructor with no parameters for compatability with OneWire lib
@@ -8,9 +9,7 @@ OneWire::OneWire()
 	// Address is determined by two pins on the DS2482 AD1/AD0
 	// Pass 0b00, 0b01, 0b10 or 0b11
 	mAddress = 0x18;
-	mError = 0;
-	APU=0;
-	_idle=0;
+	init();
 	Wire.begin();
 }
 
@@ -19,10 +18,68 @@ OneWire::OneWire(uint8_t address)
 	// Address is determined by two pins on the DS2482 AD1/AD0
 	// Pass 0b00, 0b01, 0b10 or 0b11
 	mAddress = 0x18 | address;
+	init();
+	Wire.begin();
+}
+
+// Bridge behind channel muxChannel (0-7) of a TCA9548A whose A2..A0 pins are muxAddress
+// (0-7, or the full address 0x70-0x77). The mux is only switched when the previous
+// access went through another channel.
+OneWire::OneWire(uint8_t address, uint8_t muxAddress, uint8_t muxChannel)
+{
+	mAddress = 0x18 | address;
+	init();
+	mMuxAddress = ONEWIRE_MUX_BASE | muxAddress;
+	mMuxChannel = muxChannel;
+	Wire.begin();
+}
+
+// Runs the 1-Wire API on a DS2480B serial line driver; begin() it before use
+OneWire::OneWire(DS2480B &master)
+{
+	mAddress = 0;
+	init();
+	mSerial = &master;
+}
+
+// State shared by all constructors
+void OneWire::init()
+{
 	mError = 0;
 	APU=0;
+	mConfig = 0;
+	mChannel = 0;
+	mPointer = DS2482_POINTER_UNKNOWN;
+	mBurst = 1;
 	_idle=0;
-	Wire.begin();
+	_idleBudget=0;
+	_preempt=0;
+	mPreempting = 0;
+	_reading=0;
+	mOverdrive = 0;
+	mBusyTime = 0;
+	mDeviceCount = 0;
+	mAcquireMode = ONEWIRE_ACQUIRE_BROADCAST;
+	mShedLevel = ONEWIRE_SHED_NONE;
+	mPhase = ONEWIRE_PHASE_IDLE;
+	mConvertPoll = 0;
+	mMeasuredConvert = 0;
+	mReadIndex = 0;
+	mReadN = 0;
+	mReadOp = 0;
+	mGroupPending = 0;
+	mCacheMaxAge = ONEWIRE_SEARCH_CACHE_OFF;
+	clearStats();
+	mCacheValid = 0;
+	mCacheReplay = 0;
+	mSearchOverflow = 0;
+	mLastPresence = 0;
+	mSerial = 0;
+	mMuxAddress = ONEWIRE_MUX_NONE;
+	mMuxChannel = 0;
+	mBoundChannel = ONEWIRE_CHANNEL_NONE;
+	mQuarantine = 0;
+	wireResetSearch();
 }
 
 void OneWire::idle(void (*idle)())
@@ -30,25 +87,172 @@ void OneWire::idle(void (*idle)())
   _idle = idle;
 }
 
+// Registers a hook called once per bus wait with the expected remaining busy time in us,
+// so bounded work can be done while the bridge is busy
+void OneWire::idleBudget(void (*idle)(uint32_t us))
+{
+	_idleBudget = idle;
+}
+
+// Registers a hook that long operations (enumeration, memory reads and flushes) call at
+// safe 1-Wire boundaries. The hook may run urgent transactions on this bus and returns
+// true if it did, so the interrupted operation re-selects its device before going on.
+void OneWire::preempt(bool (*hook)())
+{
+	_preempt = hook;
+}
+
+// Registers a hook called by the acquisition cycle for every valid reading, e.g. to
+// feed a OneWireHistory
+void OneWire::readingHook(void (*hook)(const OneWireDevice *device))
+{
+	_reading = hook;
+}
+
+// Hands the bus to the preempt hook. The search state is kept across it so an
+// interrupted enumeration resumes where it stopped; the hook cannot nest.
+bool OneWire::preemptPoint()
+{
+	if (!_preempt || mPreempting)
+		return false;
+
+	uint8_t address[8];
+	int8_t lastDiscrepancy = searchLastDiscrepancy;
+	uint8_t lastDeviceFlag = searchLastDeviceFlag;
+	memcpy(address, searchAddress, 8);
+
+	mPreempting = 1;
+	bool used = _preempt();
+	mPreempting = 0;
+
+	memcpy(searchAddress, address, 8);
+	searchLastDiscrepancy = lastDiscrepancy;
+	searchLastDeviceFlag = lastDeviceFlag;
+	return used;
+}
+
 uint8_t OneWire::getAddress()
 {
 	return mAddress;
 }
 
+// Mux address and channel as one key, for grouping bridges behind the same channel
+uint16_t OneWire::getMuxPath()
+{
+	return (mMuxAddress << 8) | mMuxChannel;
+}
+
 uint8_t OneWire::getError()
 {
 	return mError;
 }
 
+uint8_t OneWire::sMuxAddress = ONEWIRE_MUX_NONE;
+uint8_t OneWire::sMuxChannel = 0;
+
+// Opens the mux channel in front of this bridge unless it is already the open one. Only
+// one mux channel is kept open at a time so bridges with the same address on different
+// channels, or on the main bus, never answer together. A mux that does not acknowledge
+// is not recorded as switched, so the next access tries again.
+void OneWire::selectMux()
+{
+	if (mMuxAddress == sMuxAddress && (mMuxAddress == ONEWIRE_MUX_NONE || mMuxChannel == sMuxChannel))
+		return;
+
+	// close the open channel of another mux, or of any mux for a bridge on the main bus
+	if (sMuxAddress != ONEWIRE_MUX_NONE && sMuxAddress != mMuxAddress)
+	{
+		mStats.transactions++;
+		Wire.beginTransmission(sMuxAddress);
+		Wire.write((uint8_t)0);
+		if (Wire.endTransmission())
+			return;
+		sMuxAddress = ONEWIRE_MUX_NONE;
+	}
+	if (mMuxAddress == ONEWIRE_MUX_NONE)
+		return;
+
+	mStats.transactions++;
+	Wire.beginTransmission(mMuxAddress);
+	Wire.write((uint8_t)(1 << mMuxChannel));
+	if (Wire.endTransmission())
+		return;
+
+	sMuxAddress = mMuxAddress;
+	sMuxChannel = mMuxChannel;
+	mStats.muxSwitches++;
+}
+
+OneWire *OneWire::sChannelOwner[ONEWIRE_CHANNEL_OWNERS];
+
+// Owner slot of the DS2482-800 this object talks to: the slot holding an object with
+// the same mux path and bridge address, else a free one. With every slot taken the
+// first is reused, which only costs its bridge one extra channel select.
+OneWire **OneWire::channelOwner()
+{
+	OneWire **slot = &sChannelOwner[0];
+	bool found = false;
+
+	for (uint8_t i = 0; i < ONEWIRE_CHANNEL_OWNERS; i++)
+	{
+		OneWire *owner = sChannelOwner[i];
+		if (!owner)
+		{
+			if (!found)
+				slot = &sChannelOwner[i];
+			found = true;
+		}
+		else if (owner->mAddress == mAddress && owner->mMuxAddress == mMuxAddress && owner->mMuxChannel == mMuxChannel)
+			return &sChannelOwner[i];
+	}
+	return slot;
+}
+
+// Binds this object to one channel of a DS2482-800, so every channel can have its own
+// OneWire with its own registry, statistics and short quarantine. The channel is switched
+// back whenever another object used the bridge in between. The objects share the
+// bridge's config register, so they should use the same pullup and speed settings.
+void OneWire::bindChannel(uint8_t channel)
+{
+	mBoundChannel = channel;
+	*channelOwner() = 0;
+}
+
+void OneWire::ensureChannel()
+{
+	OneWire **owner = channelOwner();
+
+	if (*owner == this)
+		return;
+	// claimed first, selectChannel() comes back through here and settles the owner
+	*owner = this;
+	mPointer = DS2482_POINTER_UNKNOWN;
+	selectChannel(mBoundChannel);
+}
+
+// Routes the next I2C access to this bridge through the mux and channel in front of it
+void OneWire::selectPath()
+{
+	selectMux();
+	if (mBoundChannel != ONEWIRE_CHANNEL_NONE)
+		ensureChannel();
+}
+
 // Helper functions to make dealing with I2C side easier
 void OneWire::begin()
 {
+	selectPath();
 	Wire.beginTransmission(mAddress);
 }
 
+// A failed transaction leaves the read pointer unknown
 uint8_t OneWire::end()
 {
-	return Wire.endTransmission();
+	mStats.transactions++;
+	uint8_t error = Wire.endTransmission();
+	if (error)
+		mPointer = DS2482_POINTER_UNKNOWN;
+	return error;
 }
 
 void OneWire::writeByte(uint8_t data)
@@ -56,16 +260,46 @@ void OneWire::writeByte(uint8_t data)
 	Wire.write(data); 
 }
 
+// Clocks count bytes of the selected register out of the bridge into the Wire buffer
+bool OneWire::request(uint8_t count)
+{
+	mStats.transactions++;
+	selectPath();
+	if (Wire.requestFrom(mAddress, count) == count)
+		return true;
+	mPointer = DS2482_POINTER_UNKNOWN;
+	return false;
+}
+
 uint8_t OneWire::readByte()
 {
-	Wire.requestFrom(mAddress,1u);
+	request(1);
 	return Wire.read();
 }
 
+// A status with RST set means the bridge reset itself, e.g. on a brownout: the read
+// pointer is back on the status register, channel 0 is selected and the config is
+// cleared. The config is written back, which also clears RST; the channel is selected
+// again on the next access.
+void OneWire::noteBridgeReset()
+{
+	mPointer = DS2482_POINTER_STATUS;
+	mChannel = 0;
+	mConfig &= ~DS2482_CONFIG_SPU;
+	Wire.beginTransmission(mAddress);
+	Wire.write(DS2482_COMMAND_WRITECONFIG);
+	Wire.write((uint8_t)(mConfig | (~mConfig) << 4));
+	if (!end())
+		mPointer = DS2482_POINTER_CONFIG;
+	*channelOwner() = 0;
+}
+
 // Simply starts and ends an Wire transmission
 // If no devices are present, this returns false
 uint8_t OneWire::checkPresence()
 {
+	if (mSerial)
+		return mSerial->begin();
 	#if defined(__SAM3X8E__)
 	if (waitOnBusy() & DS2482_STATUS_BUSY) return false;  //device access error
 	return true;
@@ -78,18 +312,38 @@ uint8_t OneWire::checkPresence()
 // Performs a global reset of device state machine logic. Terminates any ongoing 1-Wire communication.
 void OneWire::deviceReset()
 {
+	if (mSerial)
+	{
+		// back to standard speed, like a DS2482 whose reset clears 1WS
+		mSerial->setOverdrive(false);
+		mSerial->begin();
+		mConfig = 0;
+		mOverdrive = 0;
+		return;
+	}
 	begin();
-	write(DS2482_COMMAND_RESET);
+	writeByte(DS2482_COMMAND_RESET);
 	end();
+	// the reset clears the config register and selects channel 0
+	mConfig = 0;
+	mChannel = 0;
+	*channelOwner() = 0;
+	mOverdrive = 0;
+	mPointer = DS2482_POINTER_STATUS;
 }
 
 // Sets the read pointer to the specified register. Overwrites the read pointer position of any 1-Wire communication command in progress.
+// Skipped when the pointer is already there: 1-Wire commands leave it on the status register.
 void OneWire::setReadPointer(uint8_t readPointer)
 {
+	// a channel switch on the way moves the pointer, so it goes first
+	selectPath();
+	if (mPointer == readPointer)
+		return;
 	begin();
 	writeByte(DS2482_COMMAND_SRP);
 	writeByte(readPointer);
-	end();
+	mPointer = end() ? DS2482_POINTER_UNKNOWN : readPointer;
 }
 
 // Read the status register
@@ -106,18 +360,23 @@ uint8_t OneWire::readData()
 	return readByte();
 }
 
-// Read the config register
+// Read the config register, which also refreshes the shadow copy and the speed
 uint8_t OneWire::readConfig()
 { int conf;
+	if (mSerial)
+		return mConfig;
 	setReadPointer(DS2482_POINTER_CONFIG);
 	conf=readByte();
 ///	Serial.print("Conf: ");Serial.println(conf,BIN);
+	mConfig = conf;
+	mOverdrive = conf & DS2482_CONFIG_1WS;
 	return conf;
 }
 
+// The config bits are written from the shadow copy instead of being read back first
 void OneWire::setStrongPullup()
 {
-	writeConfig(readConfig() | DS2482_CONFIG_SPU);
+	writeConfig(mConfig | DS2482_CONFIG_SPU);
 }
 
 void OneWire::setActivePullup()
@@ -127,20 +386,92 @@ APU=1;
 
 void OneWire::clearStrongPullup()
 {
-	writeConfig(readConfig() & !DS2482_CONFIG_SPU);
+	writeConfig(mConfig & ~DS2482_CONFIG_SPU);
+}
+
+// Records the expected busy time of a 1-Wire command just issued. A reset is passed as 0 slots.
+void OneWire::startBusy(uint8_t slots)
+{
+	if (slots)
+		mBusyTime = slots * (mOverdrive ? DS2482_TIME_SLOT_OD : DS2482_TIME_SLOT);
+	else
+		mBusyTime = mOverdrive ? DS2482_TIME_RESET_OD : DS2482_TIME_RESET;
+	mBusyStart = micros();
+	mStats.busyTime += mBusyTime;
+	mPointer = DS2482_POINTER_STATUS;
+}
+
+// Expected time in us until the last issued command completes
+uint32_t OneWire::busyRemaining()
+{
+	uint32_t elapsed = micros() - mBusyStart;
+	return elapsed < mBusyTime ? mBusyTime - elapsed : 0;
+}
+
+// Lets waitOnBusy() read the status in bursts, on by default
+void OneWire::burstPoll(bool on)
+{
+	mBurst = on;
+}
+
+// Reads the status register. Every byte clocked out of the bridge is a fresh status
+// sample, so while the last command is expected to run for a while one read fetches
+// a burst of samples spaced by the I2C byte time and returns the first one that is no
+// longer busy. A burst covers at most ONEWIRE_POLL_SLICE us, so the idle hook still
+// runs between bursts. Short waits use single reads. A bridge that does not answer
+// reads as idle, with DS2482_ERROR_I2C set.
+uint8_t OneWire::pollStatus()
+{
+	uint8_t count = 1;
+
+	setReadPointer(DS2482_POINTER_STATUS);
+	if (mBurst)
+	{
+		uint32_t remaining = busyRemaining();
+		if (remaining > ONEWIRE_POLL_SLICE)
+			remaining = ONEWIRE_POLL_SLICE;
+		if (remaining >= 2 * DS2482_TIME_I2C_BYTE)
+			count = remaining / DS2482_TIME_I2C_BYTE + 1 < ONEWIRE_POLL_BURST ? remaining / DS2482_TIME_I2C_BYTE + 1 : ONEWIRE_POLL_BURST;
+	}
+	if (!request(count))
+	{
+		mError = DS2482_ERROR_I2C;
+		return 0;
+	}
+	uint8_t status = DS2482_STATUS_BUSY;
+	for (uint8_t i = 0; i < count; i++)
+	{
+		uint8_t sample = Wire.read();
+		if (status & DS2482_STATUS_BUSY)
+			status = sample;
+	}
+	if (status & DS2482_STATUS_RST)
+		noteBridgeReset();
+	return status;
 }
 
 // Churn until the busy bit in the status register is clear
 uint8_t OneWire::waitOnBusy()
 {
 	uint8_t status;
+	bool budgetGiven = false;
         unsigned long ms=millis()+1000;
          
 	while (millis()<ms)
 	{
-		status = readStatus();
+		// the budget goes out before the first poll, which would otherwise sit in
+		// the bus for the expected busy time
+		if (_idleBudget && !budgetGiven)
+		{
+			budgetGiven = true;
+			uint32_t budget = busyRemaining();
+			if (budget)
+				_idleBudget(budget);
+		}
+		status = pollStatus();
 		if (!(status & DS2482_STATUS_BUSY))
 			return status;
+		mStats.polls++;
 		   if (_idle)
     			{
     			_idle();
@@ -151,24 +482,131 @@ uint8_t OneWire::waitOnBusy()
 
 	// if we have reached this point and we are still busy, there is an error
 		mError = DS2482_ERROR_TIMEOUT;
+		mStats.timeouts++;
 		Serial.println("1w Timeout");
 	// Return the status so we don't need to explicitly do it again
 	return status;
 }
 
-// Write to the config register
+// Write to the config register. A DS2480B has none: 1WS switches its speed, and since
+// its strong pullup only follows wireWriteByte(data, power), asking for SPU or APU
+// sets DS2482_ERROR_CONFIG.
 void OneWire::writeConfig(uint8_t config)
 {
+	if (mSerial)
+	{
+		if ((config ^ mConfig) & DS2482_CONFIG_1WS)
+			mSerial->setOverdrive(config & DS2482_CONFIG_1WS);
+		if (config & (DS2482_CONFIG_SPU | DS2482_CONFIG_APU))
+			mError = DS2482_ERROR_CONFIG;
+		mConfig = config & DS2482_CONFIG_1WS;
+		mOverdrive = config & DS2482_CONFIG_1WS;
+		return;
+	}
 	waitOnBusy();
 	begin();
 	writeByte(DS2482_COMMAND_WRITECONFIG);
 	// Write the 4 bits and the complement 4 bits
 	writeByte(config | (~config)<<4);
 	end();
+	mPointer = DS2482_POINTER_CONFIG;
 	
 	// This should return the config bits without the complement
 	if (readByte() != config)
 		mError = DS2482_ERROR_CONFIG;
+	mConfig = config;
+	mOverdrive = config & DS2482_CONFIG_1WS;
+}
+
+// Selects the 1-Wire channel of a DS2482-800. The bridge answers with a channel specific
+// code; a DS2482-100 does not know the command and the check fails.
+bool OneWire::selectChannel(uint8_t channel)
+{
+	static const uint8_t PROGMEM codes[8] = { 0xF0, 0xE1, 0xD2, 0xC3, 0xB4, 0xA5, 0x96, 0x87 };
+	static const uint8_t PROGMEM checks[8] = { 0xB8, 0xB1, 0xAA, 0xA3, 0x9C, 0x95, 0x8E, 0x87 };
+
+	if (channel > 7)
+		return false;
+	waitOnBusy();
+	begin();
+	writeByte(DS2482_COMMAND_CHANNEL);
+	writeByte(pgm_read_byte(&codes[channel]));
+	end();
+	mPointer = DS2482_POINTER_CHANNEL;
+
+	// the bridge now serves whichever object is bound to this channel, if it is us
+	OneWire **owner = channelOwner();
+	if (readByte() != pgm_read_byte(&checks[channel]))
+	{
+		*owner = 0;
+		return false;
+	}
+	*owner = mBoundChannel == channel ? this : 0;
+	mChannel = channel;
+	return true;
+}
+
+uint8_t OneWire::getChannel()
+{
+	return mChannel;
+}
+
+// Waits for a fixed time such as a temperature conversion, offering the whole
+// window to the idle budget hook first
+void OneWire::wireDelay(uint16_t ms)
+{
+	unsigned long start = millis();
+
+	if (_idleBudget)
+		_idleBudget((uint32_t)ms * 1000);
+	while (millis() - start < ms)
+	{
+		if (_idle)
+			_idle();
+		delay(1);
+	}
+}
+
+// A segment whose reset finds the line shorted is quarantined: until the next probe,
+// spaced by a doubling interval, resets fail without touching the bus and its devices
+// are marked offline. The first reset without a short brings it back.
+void OneWire::noteShort(bool shorted)
+{
+	if (shorted)
+	{
+		mError = DS2482_ERROR_SHORT;
+		mStats.shorts++;
+		mQuarantine = mQuarantine ? mQuarantine * 2 : ONEWIRE_QUARANTINE_MIN;
+		if (mQuarantine > ONEWIRE_QUARANTINE_MAX)
+			mQuarantine = ONEWIRE_QUARANTINE_MAX;
+		mQuarantineStart = millis();
+		for (uint8_t i = 0; i < mDeviceCount; i++)
+			mDevices[i].flags = (mDevices[i].flags & ~ONEWIRE_DEVICE_VALID) | ONEWIRE_DEVICE_OFFLINE;
+		return;
+	}
+
+	if (mError == DS2482_ERROR_SHORT)
+		mError = 0;
+	if (mQuarantine)
+	{
+		mQuarantine = 0;
+		for (uint8_t i = 0; i < mDeviceCount; i++)
+			mDevices[i].flags &= ~ONEWIRE_DEVICE_OFFLINE;
+	}
+}
+
+bool OneWire::quarantined()
+{
+	return mQuarantine != 0;
+}
+
+// Time in ms until a quarantined segment is probed again, 0 if it is due or healthy
+uint32_t OneWire::quarantineDue()
+{
+	if (!mQuarantine)
+		return 0;
+	unsigned long elapsed = millis() - mQuarantineStart;
+	return elapsed < mQuarantine ? mQuarantine - elapsed : 0;
 }
 
 // Generates a 1-Wire reset/presence-detect cycle (Figure 4) at the 1-Wire line. The state
@@ -176,39 +614,57 @@ void OneWire::writeConfig(uint8_t config)
 // processor through the Status Register, bits PPD and SD.
 uint8_t OneWire::wireReset()
 {
+	// after a reset read slots no longer report conversion status
+	if (mConvertPoll == 1)
+		mConvertPoll = 0;
+	if (quarantineDue())
+		return false;
+	if (mSerial)
+	{
+		uint8_t presence = mSerial->reset();
+		noteShort(presence == DS2480B_RESET_SHORT);
+		return notePresence(presence == DS2480B_RESET_PRESENCE || presence == DS2480B_RESET_ALARM);
+	}
 	if (waitOnBusy() & DS2482_STATUS_BUSY) 
 			{
 			return false;  //device access error
 			}
 	// Datasheet warns that reset with SPU set can exceed max ratings
-	clearStrongPullup();
-
-	waitOnBusy();
+	if (mConfig & DS2482_CONFIG_SPU)
+		clearStrongPullup();
 
 	begin();
 	writeByte(DS2482_COMMAND_RESETWIRE);
 	end();
+	startBusy(0);
 
 	uint8_t status = waitOnBusy();
 
-	if (status & DS2482_STATUS_SD)
-	{
-		mError = DS2482_ERROR_SHORT;
-	}
-	else if (mError == DS2482_ERROR_SHORT)
-	{
-	        mError = 0;    
-	}
+	noteShort(status & DS2482_STATUS_SD);
 	
-	if (APU) writeConfig(readConfig() | DS2482_CONFIG_APU);// | DS2482_CONFIG_SPU);
+	if (APU && !(mConfig & DS2482_CONFIG_APU)) writeConfig(mConfig | DS2482_CONFIG_APU);// | DS2482_CONFIG_SPU);
 //        Serial.print("Reseted: :");readConfig();
 
-	return (status & DS2482_STATUS_PPD) ? true : false;
+	return notePresence((status & DS2482_STATUS_PPD) ? true : false);
+}
+
+// A change in presence means devices came or went, so cached search results are stale
+uint8_t OneWire::notePresence(uint8_t present)
+{
+	if (present != mLastPresence)
+		mCacheValid = 0;
+	mLastPresence = present;
+	return present;
 }
 
 // Writes a single data byte to the 1-Wire line.
 void OneWire::wireWriteByte(uint8_t data, uint8_t power)
 {
+	if (mSerial)
+	{
+		mSerial->touchByte(data, power);
+		return;
+	}
 	waitOnBusy();
 	if (power)
 		setStrongPullup();
@@ -216,15 +672,19 @@ void OneWire::wireWriteByte(uint8_t data, uint8_t power)
 	writeByte(DS2482_COMMAND_WRITEBYTE);
 	writeByte(data);
 	end();
+	startBusy(8);
 }
 
 // Generates eight read-data time slots on the 1-Wire line and stores result in the Read Data Register.
 uint8_t OneWire::wireReadByte()
 {
+	if (mSerial)
+		return mSerial->touchByte(0xFF);
 	waitOnBusy();
 	begin();
 	writeByte(DS2482_COMMAND_READBYTE);
 	end();
+	startBusy(8);
 	waitOnBusy();
 	return readData();
 }
@@ -235,6 +695,11 @@ uint8_t OneWire::wireReadByte()
 // level at the 1-Wire line is tested at tMSR and SBR is updated.
 void OneWire::wireWriteBit(uint8_t data, uint8_t power)
 {
+	if (mSerial)
+	{
+		mSerial->touchBit(data);
+		return;
+	}
 	waitOnBusy();
 	if (power)
 		setStrongPullup();
@@ -242,16 +707,44 @@ void OneWire::wireWriteBit(uint8_t data, uint8_t power)
 	writeByte(DS2482_COMMAND_SINGLEBIT);
 	writeByte(data ? 0x80 : 0x00);
 	end();
+	startBusy(1);
 }
 
 // As wireWriteBit
 uint8_t OneWire::wireReadBit()
 {
+	if (mSerial)
+		return mSerial->touchBit(1);
 	wireWriteBit(1);
 	uint8_t status = waitOnBusy();
 	return status & DS2482_STATUS_SBR ? 1 : 0;
 }
 
+// Waits for a conversion started with Skip ROM to finish on every device. While any of
+// them is converting it holds read slots low, so one slot every ONEWIRE_CONVERT_POLL ms
+// shows when the slowest is done. Parasite powered devices need the strong pullup for
+// the whole conversion, so with any of them on the bus it just waits timeout ms.
+// Returns the measured time in ms, or ONEWIRE_CONVERT_TIMEOUT after timeout ms.
+uint16_t OneWire::wireWaitConvert(uint16_t timeout)
+{
+	unsigned long start = millis();
+
+	for (uint8_t i = 0; i < mDeviceCount; i++)
+		if (mDevices[i].flags & ONEWIRE_DEVICE_PARASITE)
+		{
+			wireDelay(timeout);
+			return ONEWIRE_CONVERT_TIMEOUT;
+		}
+
+	while (!wireReadBit())
+	{
+		if (millis() - start >= timeout)
+			return ONEWIRE_CONVERT_TIMEOUT;
+		wireDelay(ONEWIRE_CONVERT_POLL);
+	}
+	return millis() - start;
+}
+
 // 1-Wire skip
 void OneWire::wireSkip()
 {
@@ -265,6 +758,35 @@ void OneWire::wireSelect(const uint8_t rom[8])
 		wireWriteByte(rom[i]);
 }
 
+// Writes a block of bytes to the 1-Wire line.
+void OneWire::wireWriteBlock(const uint8_t *buf, uint8_t count)
+{
+	for (uint8_t i = 0; i < count; i++)
+		wireWriteByte(buf[i]);
+}
+
+// Reads a block of bytes from the 1-Wire line. The bridge is known to be idle
+// after each data register read, so only the busy wait after the read command is needed.
+void OneWire::wireReadBlock(uint8_t *buf, uint8_t count)
+{
+	if (mSerial)
+	{
+		for (uint8_t i = 0; i < count; i++)
+			buf[i] = mSerial->touchByte(0xFF);
+		return;
+	}
+	waitOnBusy();
+	for (uint8_t i = 0; i < count; i++)
+	{
+		begin();
+		writeByte(DS2482_COMMAND_READBYTE);
+		end();
+		startBusy(8);
+		waitOnBusy();
+		buf[i] = readData();
+	}
+}
+
 
 
 ///Alternative
@@ -382,16 +904,10 @@ void OneWire::wireResetSearch()
 
 }
 
-// Perform a search of the 1-Wire bus
-int8_t OneWire::wireSearch(uint8_t *address)
+// One search pass with the DS2482 triplet command, one ROM bit per triplet
+int8_t OneWire::searchTriplets(int8_t *lastZero)
 {
 	uint8_t direction;
-	int8_t last_zero=-1; ///
-
-	if (searchLastDeviceFlag)
-		{
-		//Serial.println("last device");
-		return 0;}
 
 	if (!wireReset())
 	
@@ -404,19 +920,21 @@ int8_t OneWire::wireSearch(uint8_t *address)
 //Serial.print("comser: :");readConfig();
 	for(uint8_t i=0;i<64;i++)
 	{
-		int searchByte = i / 8; 
-		int searchBit = 1 << i % 8;
+		// 8 bit index math; int shifts cost a 16 bit loop on AVR
+		uint8_t searchByte = i >> 3;
+		uint8_t searchBit = 1 << (i & 7);
 
-		if (i < searchLastDiscrepancy)
+		if ((int8_t)i < searchLastDiscrepancy)
 			direction = searchAddress[searchByte] & searchBit;
 		else
-			direction = i == searchLastDiscrepancy;
+			direction = (int8_t)i == searchLastDiscrepancy;
 
 		waitOnBusy();
 		begin();
 		writeByte(DS2482_COMMAND_TRIPLET);
 		writeByte(direction ? 0x80 : 0x00);
 		end();
+		startBusy(3);
 
 		uint8_t status = waitOnBusy();
 //Serial.print("triplet: :");readConfig();
@@ -433,7 +951,7 @@ int8_t OneWire::wireSearch(uint8_t *address)
 	///	if (1){
 			if (!id && !comp_id && !direction)
 			{
-				last_zero = i;
+				*lastZero = i;
 			}
 	///	}
 
@@ -444,6 +962,35 @@ int8_t OneWire::wireSearch(uint8_t *address)
 
 	}
 
+	return 1;
+}
+
+// Perform a search of the 1-Wire bus
+int8_t OneWire::wireSearch(uint8_t *address)
+{
+	int8_t last_zero=-1; ///
+
+	if (searchLastDeviceFlag)
+		{
+		//Serial.println("last device");
+		return 0;}
+
+	// a fresh pass: forget which devices were seen so the registry can be pruned at the end
+	if (searchLastDiscrepancy == -1)
+	{
+		for (uint8_t i = 0; i < mDeviceCount; i++)
+			mDevices[i].flags &= ~ONEWIRE_DEVICE_SEEN;
+		mSearchOverflow = 0;
+	}
+
+	int8_t res;
+	if (mSerial)
+		res = mSerial->search(searchAddress, searchLastDiscrepancy, &last_zero);
+	else
+		res = searchTriplets(&last_zero);
+	if (res <= 0)
+		return res;
+
 	searchLastDiscrepancy = last_zero;
 
 	if (last_zero==-1)//
@@ -454,10 +1001,928 @@ int8_t OneWire::wireSearch(uint8_t *address)
 
 //Serial.print("SF: :");readConfig();
 
+	// Bind every valid ROM we see to its family driver
+	if (crc8(address, 7) == address[7] && addDevice(address) < 0)
+		mSearchOverflow = 1;
+
+	if (searchLastDeviceFlag)
+		finishSearchPass();
+
 	return 1;
 }
 #endif
 
+// Family driver table, see ONEWIRE_DRIVER_TABLE. Lookups are a linear scan over PROGMEM,
+// done once per device at bind time; the registry then keeps the table index.
+#define ONEWIRE_DRIVER_ENTRY(family, flags, scratchpad, convert, memory, config)	{ family, flags, scratchpad, convert, memory, config },
+static const OneWireDriver PROGMEM oneWireDrivers[] = { ONEWIRE_DRIVER_TABLE(ONEWIRE_DRIVER_ENTRY) };
+#undef ONEWIRE_DRIVER_ENTRY
+
+#define ONEWIRE_DRIVER_COUNT (sizeof(oneWireDrivers) / sizeof(oneWireDrivers[0]))
+
+// Returns the driver table index for a family code, or ONEWIRE_NO_DRIVER
+uint8_t OneWire::findDriver(uint8_t family)
+{
+	for (uint8_t i = 0; i < ONEWIRE_DRIVER_COUNT; i++)
+		if (pgm_read_byte(&oneWireDrivers[i].family) == family)
+			return i;
+	return ONEWIRE_NO_DRIVER;
+}
+
+// Copies a driver description out of PROGMEM
+bool OneWire::getDriver(uint8_t driver, OneWireDriver *out)
+{
+	if (driver >= ONEWIRE_DRIVER_COUNT)
+		return false;
+	memcpy_P(out, &oneWireDrivers[driver], sizeof(OneWireDriver));
+	return true;
+}
+
+uint8_t OneWire::getDeviceCount()
+{
+	return mDeviceCount;
+}
+
+OneWireDevice *OneWire::getDevice(uint8_t index)
+{
+	return index < mDeviceCount ? &mDevices[index] : 0;
+}
+
+// Returns the registry index of a ROM, or -1 if it is not known
+int8_t OneWire::findDevice(const uint8_t rom[8])
+{
+	for (uint8_t i = 0; i < mDeviceCount; i++)
+		if (!memcmp(mDevices[i].rom, rom, 8))
+			return i;
+	return -1;
+}
+
+// Replaces the registry with a table of OneWireRom in PROGMEM, so a fixed installation
+// starts sampling without a search. Returns the number of devices loaded.
+uint8_t OneWire::loadDevices(const OneWireRom *table, uint8_t count)
+{
+	if (count > ONEWIRE_MAX_DEVICES)
+		count = ONEWIRE_MAX_DEVICES;
+	for (uint8_t i = 0; i < count; i++)
+	{
+		OneWireDevice *device = &mDevices[i];
+		memcpy_P(device->rom, table[i].rom, 8);
+		device->driver = pgm_read_byte(&table[i].driver);
+		device->flags = 0;
+		device->resolution = 0;
+		device->position = 0;
+		device->skip = 0;
+		device->faults = 0;
+		device->raw = 0;
+	}
+	mDeviceCount = count;
+	mGroupPending = 0;
+	mCacheValid = 1;
+	mCacheTime = millis();
+	// the first reset must not take the table for newly arrived devices
+	mLastPresence = count ? 1 : 0;
+	return count;
+}
+
+// Adds a ROM to the registry and binds it to its family driver
+int8_t OneWire::addDevice(const uint8_t rom[8])
+{
+	int8_t index = findDevice(rom);
+	if (index >= 0)
+	{
+		mDevices[index].flags |= ONEWIRE_DEVICE_SEEN;
+		return index;
+	}
+	if (mDeviceCount >= ONEWIRE_MAX_DEVICES)
+		return -1;
+
+	OneWireDevice *device = &mDevices[mDeviceCount];
+	memcpy(device->rom, rom, 8);
+	device->driver = findDriver(rom[0]);
+	device->flags = ONEWIRE_DEVICE_SEEN;
+	device->resolution = 0;
+	device->position = 0;
+	device->skip = 0;
+	device->faults = 0;
+	device->raw = 0;
+	return mDeviceCount++;
+}
+
+// Drops devices the completed search pass did not see. The registry then matches the
+// bus, and unless it overflowed it can answer search() on its own.
+void OneWire::finishSearchPass()
+{
+	uint8_t n = 0;
+
+	for (uint8_t i = 0; i < mDeviceCount; i++)
+		if (mDevices[i].flags & ONEWIRE_DEVICE_SEEN)
+			mDevices[n++] = mDevices[i];
+	if (n != mDeviceCount)
+		mGroupPending = 0;
+	mDeviceCount = n;
+
+	mCacheValid = !mSearchOverflow;
+	mCacheTime = millis();
+}
+
+// Brings the registry up to date with a full search of the bus. Devices already known
+// keep their probed state.
+uint8_t OneWire::wireEnumerate()
+{
+	uint8_t rom[8];
+
+	wireResetSearch();
+	while (wireSearch(rom) > 0)
+		preemptPoint();
+	wireResetSearch();
+
+	return mDeviceCount;
+}
+
+// Sends a DS28EA00 chain control byte with its complement and checks the confirmation
+bool OneWire::chainCommand(uint8_t command)
+{
+	wireWriteByte(WIRE_COMMAND_CHAIN);
+	wireWriteByte(command);
+	wireWriteByte(~command);
+	return wireReadByte() == WIRE_CHAIN_VALID;
+}
+
+// Discovers DS28EA00 devices in cable order with the chain function. Each Conditional
+// Read ROM answers with the first device not yet marked done, so one ROM costs a reset
+// and a dozen bytes instead of 64 triplets. Found devices are added to the registry with
+// their position and the registry is sorted into cable order. Returns the chain length.
+uint8_t OneWire::wireChainDiscover()
+{
+	uint8_t rom[8];
+	uint8_t position = 0;
+
+	if (!wireReset())
+		return 0;
+	wireSkip();
+	if (!chainCommand(WIRE_CHAIN_ON))
+		return 0;
+
+	// devices missing from this run must not keep a slot from an earlier one
+	for (uint8_t i = 0; i < mDeviceCount; i++)
+		mDevices[i].position = 0;
+
+	while (position < 255 && wireReset())
+	{
+		wireWriteByte(WIRE_COMMAND_COND_READ_ROM);
+		wireReadBlock(rom, 8);
+
+		// nobody answering reads back as all ones: end of the chain
+		uint8_t ones = 0xFF;
+		for (uint8_t i = 0; i < 8; i++)
+			ones &= rom[i];
+		if (ones == 0xFF || crc8(rom, 7) != rom[7])
+			break;
+
+		position++;
+		int8_t index = addDevice(rom);
+		if (index >= 0)
+			mDevices[index].position = position;
+		if (!chainCommand(WIRE_CHAIN_DONE))
+			break;
+	}
+
+	if (wireReset())
+	{
+		wireSkip();
+		chainCommand(WIRE_CHAIN_OFF);
+	}
+
+	// positioned devices first, in cable order
+	for (uint8_t i = 1; i < mDeviceCount; i++)
+	{
+		OneWireDevice device = mDevices[i];
+		uint8_t key = device.position ? device.position : 0xFF;
+		uint8_t j = i;
+		for (; j > 0 && (mDevices[j - 1].position ? mDevices[j - 1].position : 0xFF) > key; j--)
+			mDevices[j] = mDevices[j - 1];
+		mDevices[j] = device;
+	}
+	mGroupPending = 0;
+
+	return position;
+}
+
+// Decodes a MAX31850 scratchpad: 14 bit thermocouple temperature with the fault flag in
+// bit 0, 12 bit cold junction temperature with the fault cause in bits 2..0, and the
+// address pins in the low nibble of the configuration byte.
+void OneWire::decodeMAX31850(const uint8_t *scratchpad, MAX31850Reading *out)
+{
+	int16_t thermocouple = scratchpad[0] | (scratchpad[1] << 8);
+	int16_t coldJunction = scratchpad[2] | (scratchpad[3] << 8);
+
+	out->thermocouple = (thermocouple >> 2) * 0.25f;
+	out->coldJunction = (coldJunction >> 4) * 0.0625f;
+	out->faults = (scratchpad[0] & 1) ? scratchpad[2] & 0x07 : 0;
+	out->address = scratchpad[4] & 0x0F;
+}
+
+// Reads and decodes a MAX31850 after a conversion. Returns false on a bus or CRC error;
+// a thermocouple fault is reported through out->faults.
+bool OneWire::readMAX31850(const uint8_t rom[8], MAX31850Reading *out)
+{
+	uint8_t buf[9];
+
+	if (rom[0] != 0x3B || !readScratchpad(rom, buf))
+		return false;
+	decodeMAX31850(buf, out);
+	return true;
+}
+
+// Reads the scratchpad of a device using its driver's length, checking the CRC8
+bool OneWire::readScratchpad(const uint8_t rom[8], uint8_t *buf)
+{
+	OneWireDriver driver;
+
+	if (!getDriver(findDriver(rom[0]), &driver) || !driver.scratchpadLen)
+		return false;
+	if (!wireReset())
+		return false;
+	wireSelect(rom);
+	wireWriteByte(WIRE_COMMAND_READ_SCRATCHPAD);
+	wireReadBlock(buf, driver.scratchpadLen);
+
+	return scratchpadValid(buf, driver.scratchpadLen);
+}
+
+// CRC8 check of a scratchpad read. All zeros, what a shorted or vanished device reads
+// as, carries a valid CRC of 0, so it is refused along with all ones.
+bool OneWire::scratchpadValid(const uint8_t *buf, uint8_t len)
+{
+	uint8_t any = 0;
+	uint8_t all = 0xFF;
+
+	for (uint8_t i = 0; i < len; i++)
+	{
+		any |= buf[i];
+		all &= buf[i];
+	}
+	if (!any || all == 0xFF)
+		return false;
+	return crc8(buf, len - 1) == buf[len - 1];
+}
+
+bool OneWire::isTemperature(const OneWireDevice *device)
+{
+	OneWireDriver driver;
+	return getDriver(device->driver, &driver) && (driver.flags & ONEWIRE_DRIVER_TEMPERATURE);
+}
+
+// Reads the power supply mode and, for programmable parts, the resolution of a device
+void OneWire::probeDevice(OneWireDevice *device)
+{
+	uint8_t buf[9];
+	OneWireDriver driver;
+
+	if (!wireReset())
+		return;
+	wireSelect(device->rom);
+	wireWriteByte(WIRE_COMMAND_READ_POWER);
+	if (wireReadBit())
+		device->flags &= ~ONEWIRE_DEVICE_PARASITE;
+	else
+		device->flags |= ONEWIRE_DEVICE_PARASITE;
+
+	if (!readScratchpad(device->rom, buf))
+		return;
+	if (getDriver(device->driver, &driver) && driver.configByte)
+		device->resolution = 9 + ((buf[driver.configByte] >> 5) & 3);
+	device->flags |= ONEWIRE_DEVICE_PROBED;
+}
+
+// Moves a low priority device to 9 bit conversions for load shedding, through the
+// scratchpad only so the EEPROM keeps its configured resolution. Recall EEPROM restores
+// it without waiting for the recall to finish: until the probe in the next cycle reads
+// the resolution back, the device is timed for the worst case.
+void OneWire::shedResolution(OneWireDevice *device, bool shed)
+{
+	uint8_t buf[9];
+	OneWireDriver driver;
+
+	if (!shed)
+	{
+		if (!wireReset())
+			return;
+		wireSelect(device->rom);
+		wireWriteByte(WIRE_COMMAND_RECALL_EEPROM);
+		device->resolution = 0;
+		device->flags &= ~(ONEWIRE_DEVICE_SHED | ONEWIRE_DEVICE_PROBED);
+		return;
+	}
+
+	// parts with a fixed resolution have nothing to shed
+	if (!getDriver(device->driver, &driver) || !driver.configByte)
+		return;
+	if (!readScratchpad(device->rom, buf) || !wireReset())
+		return;
+	wireSelect(device->rom);
+	wireWriteByte(WIRE_COMMAND_WRITE_SCRATCHPAD);
+	wireWriteByte(buf[2]);
+	wireWriteByte(buf[3]);
+	wireWriteByte(0x1F);
+	device->resolution = 9;
+	device->flags |= ONEWIRE_DEVICE_SHED;
+}
+
+// Sets how far acquisition is degraded to relieve an overloaded bus, one of
+// ONEWIRE_SHED_*. Resolution changes are applied when the next cycle starts.
+void OneWire::setShedLevel(uint8_t level)
+{
+	mShedLevel = level > ONEWIRE_SHED_MAX ? ONEWIRE_SHED_MAX : level;
+}
+
+uint8_t OneWire::getShedLevel()
+{
+	return mShedLevel;
+}
+
+// Worst case conversion time in ms, scaled down for lower resolutions
+uint16_t OneWire::conversionTime(const OneWireDevice *device)
+{
+	OneWireDriver driver;
+
+	if (!getDriver(device->driver, &driver))
+		return 0;
+	if (device->resolution)
+		return driver.convertTime >> (12 - device->resolution);
+	return driver.convertTime;
+}
+
+float OneWire::rawToCelsius(uint8_t family, int16_t raw)
+{
+	if (family == 0x10)
+		return raw * 0.5f;
+	return raw * 0.0625f;
+}
+
+// Conversion time in ms measured by the last broadcast cycle that sampled read slots,
+// 0 if none did
+uint16_t OneWire::measuredConversion()
+{
+	return mMeasuredConvert;
+}
+
+uint8_t OneWire::getAcquireMode()
+{
+	return mAcquireMode;
+}
+
+// Probes new devices and picks the acquisition mode. Pipelining needs every device to be
+// externally powered, since a parasite conversion holds the strong pullup, and pays off once
+// reading half of the devices takes a noticeable share of the conversion time.
+uint8_t OneWire::prepareAcquire(uint16_t *convert)
+{
+	uint8_t count = 0;
+	bool parasite = false;
+
+	*convert = 0;
+	for (uint8_t i = 0; i < mDeviceCount; i++)
+	{
+		OneWireDevice *device = &mDevices[i];
+		if (!isTemperature(device))
+			continue;
+		bool shed = mShedLevel >= ONEWIRE_SHED_RESOLUTION && (device->flags & ONEWIRE_DEVICE_LOW_PRIORITY);
+		bool recalled = false;
+		if (shed != !!(device->flags & ONEWIRE_DEVICE_SHED) && (device->flags & ONEWIRE_DEVICE_PROBED))
+		{
+			shedResolution(device, shed);
+			recalled = !shed;
+		}
+		// a recall may still be running, probe next cycle
+		if (!(device->flags & ONEWIRE_DEVICE_PROBED) && !recalled)
+			probeDevice(device);
+		if (device->flags & ONEWIRE_DEVICE_PARASITE)
+			parasite = true;
+		if (conversionTime(device) > *convert)
+			*convert = conversionTime(device);
+		count++;
+	}
+
+	// reset + select + command + scratchpad, in us
+	uint32_t readTime = DS2482_TIME_RESET + 19UL * (8 * DS2482_TIME_SLOT + ONEWIRE_TIME_BYTE_I2C);
+	if (!parasite && count >= ONEWIRE_PIPELINE_MIN_DEVICES && (count / 2) * readTime >= *convert * 250UL)
+		mAcquireMode = ONEWIRE_ACQUIRE_PIPELINED;
+	else
+		mAcquireMode = ONEWIRE_ACQUIRE_BROADCAST;
+	return count;
+}
+
+// Starts a conversion on every temperature device of a group with Match ROM
+void OneWire::convertGroup(uint8_t group)
+{
+	uint8_t n = 0;
+
+	for (uint8_t i = 0; i < mDeviceCount; i++)
+	{
+		if (!isTemperature(&mDevices[i]))
+			continue;
+		if ((n++ & 1) != group || mDevices[i].skip)
+			continue;
+		if (!wireReset())
+			break;
+		wireSelect(mDevices[i].rom);
+		wireWriteByte(WIRE_COMMAND_CONVERT);
+	}
+	mGroupStart[group] = millis();
+	mGroupPending |= 1 << group;
+}
+
+// Reads a device's scratchpad, trying again after a CRC error unless shedding
+bool OneWire::readDevice(OneWireDevice *device, uint8_t *buf)
+{
+	for (uint8_t i = 0; i <= ONEWIRE_CRC_RETRIES; i++)
+	{
+		if (readScratchpad(device->rom, buf))
+			return true;
+		mStats.crcErrors++;
+		if (mShedLevel >= ONEWIRE_SHED_RETRIES)
+		{
+			mStats.shedReads++;
+			break;
+		}
+	}
+	return false;
+}
+
+// True once the last command issued has finished, without waiting: no bus access while
+// it is still expected to run, then one status read per call
+bool OneWire::stepReady()
+{
+	if (busyRemaining())
+		return false;
+	mStepStatus = pollStatus();
+	if (!(mStepStatus & DS2482_STATUS_BUSY))
+		return true;
+	mStats.polls++;
+	if (micros() - mBusyStart < 1000000UL)
+		return false;
+	mError = DS2482_ERROR_TIMEOUT;
+	mStats.timeouts++;
+	return true;
+}
+
+// Issues a 1-Wire command and returns at once; the caller has seen the bridge idle
+// through stepReady()
+void OneWire::issue(uint8_t command, uint8_t data, uint8_t slots)
+{
+	if (command == DS2482_COMMAND_RESETWIRE && mConvertPoll == 1)
+		mConvertPoll = 0;
+	if (command == DS2482_COMMAND_RESETWIRE && (mConfig & DS2482_CONFIG_SPU))
+		clearStrongPullup();
+	begin();
+	writeByte(command);
+	if (command != DS2482_COMMAND_RESETWIRE && command != DS2482_COMMAND_READBYTE)
+		writeByte(data);
+	end();
+	startBusy(slots);
+}
+
+// Decodes a CRC checked temperature scratchpad into the registry entry and reports it
+// to the reading hook. Returns false on a MAX31850 thermocouple fault, which sets
+// faults and ONEWIRE_DEVICE_FAULT and keeps raw at the last good value.
+bool OneWire::storeReading(OneWireDevice *device, const uint8_t *scratchpad)
+{
+	if (device->rom[0] == 0x3B && (scratchpad[0] & 1))
+	{
+		device->faults = scratchpad[2] & 0x07;
+		device->flags = (device->flags & ~ONEWIRE_DEVICE_VALID) | ONEWIRE_DEVICE_FAULT;
+		return false;
+	}
+	device->raw = scratchpad[0] | (scratchpad[1] << 8);
+	device->faults = 0;
+	device->flags = (device->flags & ~ONEWIRE_DEVICE_FAULT) | ONEWIRE_DEVICE_VALID;
+	if (_reading)
+		_reading(device);
+	return true;
+}
+
+// Stores a finished scratchpad read, buf is 0 if it failed
+void OneWire::finishRead(OneWireDevice *device, const uint8_t *buf)
+{
+	if (!buf)
+	{
+		device->flags &= ~ONEWIRE_DEVICE_VALID;
+		return;
+	}
+	if (!storeReading(device, buf))
+	{
+		device->skip = ONEWIRE_FAULT_RETRY;
+		return;
+	}
+	mCycleValid++;
+	// stretch the period of low priority devices under load
+	if (mShedLevel >= ONEWIRE_SHED_RATE && (device->flags & ONEWIRE_DEVICE_LOW_PRIORITY))
+	{
+		device->skip = ONEWIRE_SHED_STRETCH - 1;
+		mStats.shedReads += ONEWIRE_SHED_STRETCH - 1;
+	}
+}
+
+// Moves the scratchpad read of one device on by one 1-Wire operation if the bridge is
+// idle: reset, Match ROM, the ROM, Read Scratchpad, then one read per byte. Returns true
+// once the device is done. A DS2480B answers synchronously and is read in one go.
+bool OneWire::readStep(OneWireDevice *device)
+{
+	if (mSerial)
+	{
+		uint8_t buf[9];
+		finishRead(device, readDevice(device, buf) ? buf : 0);
+		return true;
+	}
+
+	if (mReadOp)
+	{
+		if (!stepReady())
+			return false;
+		uint8_t last = mReadOp - 1;
+		if (last == 0)
+		{
+			noteShort(mStepStatus & DS2482_STATUS_SD);
+			if (APU && !(mConfig & DS2482_CONFIG_APU))
+				writeConfig(mConfig | DS2482_CONFIG_APU);
+			if (!notePresence((mStepStatus & DS2482_STATUS_PPD) ? true : false))
+			{
+				finishRead(device, 0);
+				return true;
+			}
+		}
+		else if (last >= 11)
+			mReadBuf[last - 11] = readData();
+	}
+	else
+	{
+		OneWireDriver driver;
+		if (quarantineDue() || !getDriver(device->driver, &driver) || !driver.scratchpadLen)
+		{
+			finishRead(device, 0);
+			return true;
+		}
+		mReadLen = driver.scratchpadLen;
+		mReadRetry = 0;
+	}
+
+	uint8_t next = mReadOp++;
+	if (next == 0)
+		issue(DS2482_COMMAND_RESETWIRE, 0, 0);
+	else if (next == 1)
+		issue(DS2482_COMMAND_WRITEBYTE, WIRE_COMMAND_SELECT, 8);
+	else if (next < 10)
+		issue(DS2482_COMMAND_WRITEBYTE, device->rom[next - 2], 8);
+	else if (next == 10)
+		issue(DS2482_COMMAND_WRITEBYTE, WIRE_COMMAND_READ_SCRATCHPAD, 8);
+	else if (next < 11 + mReadLen)
+		issue(DS2482_COMMAND_READBYTE, 0, 8);
+	else if (scratchpadValid(mReadBuf, mReadLen))
+	{
+		finishRead(device, mReadBuf);
+		return true;
+	}
+	else
+	{
+		mStats.crcErrors++;
+		if (mShedLevel < ONEWIRE_SHED_RETRIES && mReadRetry < ONEWIRE_CRC_RETRIES)
+		{
+			// start over with a fresh reset, the bridge is idle
+			mReadRetry++;
+			mReadOp = 1;
+			issue(DS2482_COMMAND_RESETWIRE, 0, 0);
+			return false;
+		}
+		if (mShedLevel >= ONEWIRE_SHED_RETRIES)
+			mStats.shedReads++;
+		finishRead(device, 0);
+		return true;
+	}
+	return false;
+}
+
+// Reads the scratchpads of a group without waiting on the bridge: each call does what
+// it can and returns false while a 1-Wire operation is still running, so a scheduler
+// polling several bridges overlaps their reads. Returns true once the group is done;
+// valid readings are counted in mCycleValid.
+bool OneWire::readGroup(uint8_t group)
+{
+	// a Convert T written just before may still be shifting out, and the bridge ignores
+	// commands until it is done; later devices start on an idle bridge
+	if (!mSerial && !mReadIndex && !mReadOp && !stepReady())
+		return false;
+
+	while (mReadIndex < mDeviceCount)
+	{
+		OneWireDevice *device = &mDevices[mReadIndex];
+		if (!mReadOp)
+		{
+			bool selected = isTemperature(device);
+			if (selected && group != 0xFF)
+				selected = (mReadN++ & 1) == group;
+			if (selected && (device->flags & ONEWIRE_DEVICE_OFFLINE))
+				selected = false;
+			if (selected && device->skip)
+			{
+				device->skip--;
+				selected = false;
+			}
+			if (!selected)
+			{
+				mReadIndex++;
+				continue;
+			}
+		}
+		if (!readStep(device))
+			return false;
+		mReadOp = 0;
+		mReadIndex++;
+	}
+
+	mReadIndex = 0;
+	mReadN = 0;
+	if (group != 0xFF)
+		mGroupPending &= ~(1 << group);
+	return true;
+}
+
+// Time in ms until a group's conversion is complete
+uint32_t OneWire::groupDue(uint8_t group)
+{
+	unsigned long elapsed = millis() - mGroupStart[group];
+	return elapsed < mConvertTime ? mConvertTime - elapsed : 0;
+}
+
+const OneWireStats *OneWire::getStats()
+{
+	return &mStats;
+}
+
+void OneWire::clearStats()
+{
+	memset(&mStats, 0, sizeof(mStats));
+}
+
+// Starts a non-blocking acquisition cycle over all temperature devices in the registry.
+// Returns false if a cycle is already running or there is nothing to acquire.
+bool OneWire::acquireStart()
+{
+	if (mPhase != ONEWIRE_PHASE_IDLE || !prepareAcquire(&mConvertTime))
+		return false;
+
+	mCycleStart = millis();
+	mCycleValid = 0;
+	if (mAcquireMode == ONEWIRE_ACQUIRE_BROADCAST)
+	{
+		bool parasite = false;
+		for (uint8_t i = 0; i < mDeviceCount; i++)
+			if (mDevices[i].flags & ONEWIRE_DEVICE_PARASITE)
+				parasite = true;
+		mGroupPending = 0;
+		if (!wireReset())
+		{
+			finishCycle();
+			return true;
+		}
+		wireSkip();
+		wireWriteByte(WIRE_COMMAND_CONVERT, parasite);
+		mGroupStart[0] = millis();
+		mPhase = ONEWIRE_PHASE_BROADCAST;
+		// externally powered devices report the end of the conversion in read slots
+		mConvertPoll = !parasite;
+		mConvertSample = mGroupStart[0] + ONEWIRE_CONVERT_POLL;
+		return true;
+	}
+
+	// group 1 was left converting by the previous cycle
+	convertGroup(0);
+	mPhase = (mGroupPending & 2) ? ONEWIRE_PHASE_READ_1 : ONEWIRE_PHASE_CONVERT_1;
+	return true;
+}
+
+// Time in ms until acquirePoll() has work to do; 0 if it is due now or no cycle runs.
+// Event loops arm their timer with this instead of blocking in a delay.
+uint32_t OneWire::acquireDue()
+{
+	switch (mPhase)
+	{
+	case ONEWIRE_PHASE_BROADCAST:
+		if (mConvertPoll == 2)
+			return 0;
+		if (mConvertPoll == 1)
+		{
+			long sample = (long)(mConvertSample - millis());
+			uint32_t due = groupDue(0);
+			if (sample <= 0)
+				return 0;
+			return (uint32_t)sample < due ? sample : due;
+		}
+		return groupDue(0);
+	case ONEWIRE_PHASE_CONVERT_1:
+		return groupDue(0);
+	case ONEWIRE_PHASE_READ_1:
+		return groupDue(1);
+	case ONEWIRE_PHASE_READ_0:
+		// reads move on whenever the bridge is idle
+		return 0;
+	}
+	return 0;
+}
+
+// Advances the running cycle as far as it can go without waiting. Returns true
+// once the cycle is complete; the number of valid readings is then in acquireResult().
+bool OneWire::acquirePoll()
+{
+	if (mPhase == ONEWIRE_PHASE_IDLE)
+		return true;
+	if (acquireDue())
+		return false;
+
+	switch (mPhase)
+	{
+	case ONEWIRE_PHASE_BROADCAST:
+		if (mConvertPoll == 1)
+		{
+			unsigned long elapsed = millis() - mGroupStart[0];
+			bool done = wireReadBit();
+			if (!done && elapsed < mConvertTime)
+			{
+				mConvertSample = millis() + ONEWIRE_CONVERT_POLL;
+				return false;
+			}
+			// a slot still low at the worst case time is no news, read anyway
+			if (done)
+				mMeasuredConvert = elapsed;
+			mConvertPoll = 2;
+		}
+		if (!readGroup(0xFF))
+			return false;
+		break;
+	case ONEWIRE_PHASE_READ_1:
+		if (!readGroup(1))
+			return false;
+		mPhase = ONEWIRE_PHASE_CONVERT_1;
+		if (acquireDue())
+			return false;
+		// fall through
+	case ONEWIRE_PHASE_CONVERT_1:
+		convertGroup(1);
+		mPhase = ONEWIRE_PHASE_READ_0;
+		// fall through
+	case ONEWIRE_PHASE_READ_0:
+		if (!readGroup(0))
+			return false;
+		break;
+	}
+	finishCycle();
+	return true;
+}
+
+uint8_t OneWire::acquireResult()
+{
+	return mCycleValid;
+}
+
+// True while a device transaction of the cycle is half done on the bus. Other objects
+// bound to channels of the same DS2482-800 must leave the bridge alone until it is not.
+bool OneWire::acquireBusy()
+{
+	return mReadOp != 0;
+}
+
+// True if other transactions may go on the bus now: no device transaction is half done
+// and no strong pullup is powering a parasite conversion
+bool OneWire::busFree()
+{
+	if (mSerial && mSerial->pulsing())
+		return false;
+	return !mReadOp && !(mConfig & DS2482_CONFIG_SPU);
+}
+
+void OneWire::finishCycle()
+{
+	mPhase = ONEWIRE_PHASE_IDLE;
+	mConvertPoll = 0;
+	mStats.cycles++;
+	if (mShedLevel)
+		mStats.shedCycles++;
+	mStats.readings += mCycleValid;
+	mStats.cycleTime += millis() - mCycleStart;
+}
+
+// Runs one acquisition cycle over all temperature devices in the registry and
+// returns the number of valid readings. In pipelined mode the devices are split into
+// two groups: one group converts while the other is read, and the second group's
+// conversion runs on into the next cycle.
+uint8_t OneWire::acquire()
+{
+	if (!acquireStart())
+		return 0;
+	while (!acquirePoll())
+	{
+		uint32_t due = acquireDue();
+		if (due)
+			wireDelay(due);
+		else if (_idle)
+			_idle();
+	}
+	return mCycleValid;
+}
+
+// Serializes what a node would otherwise rebuild after waking: the config shadow, the
+// active channel, the search cursor and the registry with each device's power mode,
+// resolution and position. Returns the number of bytes written, 0 if size is too small.
+uint16_t OneWire::saveState(uint8_t *buf, uint16_t size)
+{
+	uint16_t len = ONEWIRE_SNAPSHOT_SIZE(mDeviceCount);
+	uint8_t *p = buf;
+
+	if (size < len)
+		return 0;
+
+	*p++ = ONEWIRE_SNAPSHOT_MAGIC;
+	*p++ = ONEWIRE_SNAPSHOT_VERSION;
+	*p++ = mConfig & ~DS2482_CONFIG_SPU;
+	*p++ = mChannel;
+	*p++ = mDeviceCount;
+	memcpy(p, searchAddress, 8);
+	p += 8;
+	*p++ = searchLastDiscrepancy;
+	*p++ = searchLastDeviceFlag;
+
+	for (uint8_t i = 0; i < mDeviceCount; i++)
+	{
+		OneWireDevice *device = &mDevices[i];
+		memcpy(p, device->rom, 8);
+		p += 8;
+		*p++ = device->flags & (ONEWIRE_DEVICE_PARASITE | ONEWIRE_DEVICE_PROBED | ONEWIRE_DEVICE_LOW_PRIORITY | ONEWIRE_DEVICE_SHED);
+		*p++ = device->resolution;
+		*p++ = device->position;
+	}
+	*p = crc8(buf, len - 1);
+
+	return len;
+}
+
+// Restores a snapshot taken by saveState(). The bridge's RST status bit and config
+// register show whether it kept its state; if not, the config is written back, and
+// either way the overdrive flag follows the config now in the bridge. The channel of a
+// DS2482-800 is selected again whenever the snapshot or the driver is on a channel
+// other than 0, since a reset falls back to channel 0 without telling; a DS2482-100
+// does not know the command and stays on its only channel. The registry then counts
+// as a fresh search result.
+bool OneWire::restoreState(const uint8_t *buf, uint16_t len)
+{
+	if (len < ONEWIRE_SNAPSHOT_SIZE(0) || buf[0] != ONEWIRE_SNAPSHOT_MAGIC || buf[1] != ONEWIRE_SNAPSHOT_VERSION)
+		return false;
+	uint8_t count = buf[4];
+	if (count > ONEWIRE_MAX_DEVICES || len < ONEWIRE_SNAPSHOT_SIZE(count))
+		return false;
+	if (crc8(buf, ONEWIRE_SNAPSHOT_SIZE(count) - 1) != buf[ONEWIRE_SNAPSHOT_SIZE(count) - 1])
+		return false;
+
+	const uint8_t *p = buf + 2;
+	uint8_t config = *p++;
+	uint8_t channel = *p++;
+	p++;
+	memcpy(searchAddress, p, 8);
+	p += 8;
+	searchLastDiscrepancy = *p++;
+	searchLastDeviceFlag = *p++;
+
+	mDeviceCount = count;
+	for (uint8_t i = 0; i < count; i++)
+	{
+		OneWireDevice *device = &mDevices[i];
+		memcpy(device->rom, p, 8);
+		p += 8;
+		device->driver = findDriver(device->rom[0]);
+		device->flags = *p++;
+		device->resolution = *p++;
+		device->position = *p++;
+		// a shed device that lost power is back at its EEPROM resolution; time it for the
+		// worst case until the recall of the first cycle has been probed
+		if (device->flags & ONEWIRE_DEVICE_SHED)
+			device->resolution = 0;
+		device->skip = 0;
+		device->faults = 0;
+		device->raw = 0;
+	}
+	mGroupPending = 0;
+	mCacheValid = 1;
+	mCacheTime = millis();
+	// the first reset must not take the saved devices for newly arrived ones
+	mLastPresence = count ? 1 : 0;
+
+	if (mSerial)
+		return true;
+	if ((readStatus() & DS2482_STATUS_RST) || readConfig() != config)
+		writeConfig(config);
+	if ((channel || mChannel) && !selectChannel(channel))
+		return false;
+	return !(mError & DS2482_ERROR_CONFIG);
+}
+
 #if ONEWIRE_CRC8_TABLE
 // This table comes from Dallas sample code where it is freely reusable,
 // though Copyright (C) 2000 Dallas Semiconductor Corporation
@@ -548,6 +2013,27 @@ uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len)
 }
 #endif
 
+// Lets search() replay the registry instead of searching the bus, as long as the last
+// full pass is younger than maxAge ms and presence has not changed. Libraries that look
+// devices up by index restart the search for every index, which this makes linear.
+void OneWire::searchCache(uint32_t maxAge)
+{
+	mCacheMaxAge = maxAge;
+}
+
+// Forces the next search pass onto the bus
+void OneWire::invalidateSearchCache()
+{
+	mCacheValid = 0;
+}
+
+bool OneWire::searchCacheValid()
+{
+	if (!mCacheValid || mCacheMaxAge == ONEWIRE_SEARCH_CACHE_OFF)
+		return false;
+	return mCacheMaxAge == ONEWIRE_SEARCH_CACHE_FOREVER || millis() - mCacheTime < mCacheMaxAge;
+}
+
 // ****************************************
 // These are here to mirror the functions in the original OneWire
 // ****************************************
@@ -557,10 +2043,20 @@ uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len)
 void OneWire::reset_search()
 {
 	wireResetSearch();
+	// decided once per pass so a pass never mixes cached and live results
+	mCacheReplay = searchCacheValid();
+	mCacheIndex = 0;
 }
 
 uint8_t OneWire::search(uint8_t *newAddr)
 {       int res;
+	if (mCacheReplay)
+	{
+		if (mCacheIndex >= mDeviceCount)
+			return 0;
+		memcpy(newAddr, mDevices[mCacheIndex++].rom, 8);
+		return 1;
+	}
 	res=  wireSearch(newAddr);
 	if (res>0) return res;
 	    else return 0;
@@ -24,6 +24,8 @@
 		#define DS2482_CONFIG_APU			(1<<0)
 		#define DS2482_CONFIG_SPU			(1<<2)
 		#define DS2482_CONFIG_1WS			(1<<3)
+	#define DS2482_POINTER_CHANNEL		0xD2	// DS2482-800 only
+	#define DS2482_POINTER_UNKNOWN		0
 
 
 #define DS2482_COMMAND_WRITECONFIG	0xD2
@@ -32,22 +34,304 @@
 #define DS2482_COMMAND_READBYTE		0x96
 #define DS2482_COMMAND_SINGLEBIT	0x87
 #define DS2482_COMMAND_TRIPLET		0x78
+#define DS2482_COMMAND_CHANNEL		0xC3	// DS2482-800 channel select
 
 #define WIRE_COMMAND_SKIP			0xCC
 #define WIRE_COMMAND_SELECT			0x55
 #define WIRE_COMMAND_SEARCH			0xF0
+#define WIRE_COMMAND_OVERDRIVE_SKIP	0x3C
+#define WIRE_COMMAND_CONVERT		0x44
+#define WIRE_COMMAND_READ_SCRATCHPAD	0xBE
+#define WIRE_COMMAND_READ_POWER		0xB4
+#define WIRE_COMMAND_WRITE_SCRATCHPAD	0x4E
+#define WIRE_COMMAND_RECALL_EEPROM	0xB8
+#define WIRE_COMMAND_COND_READ_ROM	0x0F
+#define WIRE_COMMAND_CHAIN			0x99	// DS28EA00 chain function
+	#define WIRE_CHAIN_ON				0x5A
+	#define WIRE_CHAIN_OFF				0x3C
+	#define WIRE_CHAIN_DONE				0x96
+	#define WIRE_CHAIN_VALID			0xAA
+
+// Nominal 1-Wire busy times in us, used to size idle budgets
+#define DS2482_TIME_RESET			1148
+#define DS2482_TIME_RESET_OD		146
+#define DS2482_TIME_SLOT			73
+#define DS2482_TIME_SLOT_OD			11
+
+// Time in us to clock one byte from the bridge, at 100kHz
+#ifndef DS2482_TIME_I2C_BYTE
+#define DS2482_TIME_I2C_BYTE		90
+#endif
+
+// Most status bytes read in one burst poll, within the Wire buffer
+#ifndef ONEWIRE_POLL_BURST
+#define ONEWIRE_POLL_BURST			16
+#endif
+
+// Longest time in us one burst poll may hold the bus before the idle hook runs again
+#ifndef ONEWIRE_POLL_SLICE
+#define ONEWIRE_POLL_SLICE			500
+#endif
+
+// Driver state snapshot format, see saveState()
+#define ONEWIRE_SNAPSHOT_MAGIC		0xD5
+#define ONEWIRE_SNAPSHOT_VERSION	1
+#define ONEWIRE_SNAPSHOT_HEADER		15		// magic, version, config, channel, count, search state
+#define ONEWIRE_SNAPSHOT_DEVICE		11		// rom, flags, resolution, position
+#define ONEWIRE_SNAPSHOT_SIZE(devices)	(ONEWIRE_SNAPSHOT_HEADER + (devices) * ONEWIRE_SNAPSHOT_DEVICE + 1)
+
+// TCA9548A/PCA9548 I2C multiplexer, addresses 0x70-0x77
+#define ONEWIRE_MUX_NONE			0
+#define ONEWIRE_MUX_BASE			0x70
+
+// Channel binding for bindChannel()
+#define ONEWIRE_CHANNEL_NONE		0xFF
+
+// DS2482-800 bridges whose selected channel is tracked for bound objects
+#ifndef ONEWIRE_CHANNEL_OWNERS
+#define ONEWIRE_CHANNEL_OWNERS		8
+#endif
+
+// Probe interval in ms for a segment quarantined after a short, doubled per failed probe
+#ifndef ONEWIRE_QUARANTINE_MIN
+#define ONEWIRE_QUARANTINE_MIN		1000
+#endif
+#ifndef ONEWIRE_QUARANTINE_MAX
+#define ONEWIRE_QUARANTINE_MAX		60000
+#endif
 
 #define DS2482_ERROR_TIMEOUT		(1<<0)
 #define DS2482_ERROR_SHORT			(1<<1)
 #define DS2482_ERROR_CONFIG			(1<<2)
+#define DS2482_ERROR_I2C			(1<<3)	// the bridge did not answer a read
+
+// Size of the device registry filled by wireSearch()/wireEnumerate(). Every OneWire
+// object carries the whole registry, 16 bytes per entry, so 2 KB AVR parts such as the
+// ATmega328 get a small one. Override with a build flag such as -DONEWIRE_MAX_DEVICES=8,
+// so the library sources and the sketch see the same size.
+#ifndef ONEWIRE_MAX_DEVICES
+#if defined(RAMEND) && RAMEND < 0x1000
+#define ONEWIRE_MAX_DEVICES			4
+#else
+#define ONEWIRE_MAX_DEVICES			16
+#endif
+#endif
+
+// Family driver capabilities
+#define ONEWIRE_DRIVER_TEMPERATURE	(1<<0)	// Convert T (0x44) + Read Scratchpad (0xBE)
+#define ONEWIRE_DRIVER_MEMORY		(1<<1)	// Read Memory / scratchpad-copy EEPROM
+#define ONEWIRE_DRIVER_SWITCH		(1<<2)	// PIO switch
+#define ONEWIRE_DRIVER_ADC			(1<<3)	// A/D or battery monitor
+#define ONEWIRE_NO_DRIVER			0xFF
+
+// Registry device flags
+#define ONEWIRE_DEVICE_PARASITE		(1<<0)	// device reported parasite power
+#define ONEWIRE_DEVICE_PROBED		(1<<1)	// power mode and resolution are known
+#define ONEWIRE_DEVICE_VALID		(1<<2)	// raw holds a CRC checked reading
+#define ONEWIRE_DEVICE_SEEN			(1<<3)	// found by the current search pass
+#define ONEWIRE_DEVICE_FAULT		(1<<4)	// sensor reported a fault, read again after skip cycles
+#define ONEWIRE_DEVICE_LOW_PRIORITY	(1<<5)	// degraded first when the bus is overloaded, set by the sketch
+#define ONEWIRE_DEVICE_SHED			(1<<6)	// resolution lowered by load shedding, EEPROM holds the real one
+#define ONEWIRE_DEVICE_OFFLINE		(1<<7)	// segment is quarantined after a short
+
+// acquire() cycles a faulted device is left out before it is tried again
+#ifndef ONEWIRE_FAULT_RETRY
+#define ONEWIRE_FAULT_RETRY			8
+#endif
+
+// Load shedding levels, each includes the ones below
+#define ONEWIRE_SHED_NONE			0
+#define ONEWIRE_SHED_RETRIES		1		// no CRC re-reads
+#define ONEWIRE_SHED_RATE			2		// low priority devices read every ONEWIRE_SHED_STRETCH cycles
+#define ONEWIRE_SHED_RESOLUTION		3		// low priority devices converted at 9 bits
+#define ONEWIRE_SHED_MAX			ONEWIRE_SHED_RESOLUTION
+
+#ifndef ONEWIRE_SHED_STRETCH
+#define ONEWIRE_SHED_STRETCH		4
+#endif
+
+// Scratchpad re-reads after a CRC error while not shedding
+#ifndef ONEWIRE_CRC_RETRIES
+#define ONEWIRE_CRC_RETRIES			1
+#endif
+
+// MAX31850 thermocouple fault bits, scratchpad byte 2
+#define MAX31850_FAULT_OPEN			(1<<0)
+#define MAX31850_FAULT_SHORT_GND	(1<<1)
+#define MAX31850_FAULT_SHORT_VCC	(1<<2)
+
+// Decoded MAX31850 scratchpad
+struct MAX31850Reading
+{
+	float thermocouple;		// degrees C, 0.25 resolution
+	float coldJunction;		// degrees C, 0.0625 resolution
+	uint8_t faults;			// MAX31850_FAULT_*, 0 if the reading is good
+	uint8_t address;		// AD3..AD0 hardware address pins
+};
+
+// Search result cache lifetimes for searchCache()
+#define ONEWIRE_SEARCH_CACHE_OFF	0
+#define ONEWIRE_SEARCH_CACHE_FOREVER	0xFFFFFFFFUL
+
+// Acquisition modes chosen by acquire()
+#define ONEWIRE_ACQUIRE_BROADCAST	0		// Skip ROM convert, wait, read all
+#define ONEWIRE_ACQUIRE_PIPELINED	1		// convert one half while reading the other
+
+// Phases of a non-blocking acquisition cycle
+#define ONEWIRE_PHASE_IDLE			0
+#define ONEWIRE_PHASE_BROADCAST		1		// broadcast conversion running
+#define ONEWIRE_PHASE_READ_1		2		// group 1 from the last cycle to be read
+#define ONEWIRE_PHASE_CONVERT_1		3		// group 0 converting, group 1 to be started
+#define ONEWIRE_PHASE_READ_0		4		// group 1 converting, group 0 being read
+
+// Minimum number of temperature devices before pipelining is considered
+#ifndef ONEWIRE_PIPELINE_MIN_DEVICES
+#define ONEWIRE_PIPELINE_MIN_DEVICES	4
+#endif
+
+// Spacing in ms of the read slots that detect the end of a broadcast conversion
+#ifndef ONEWIRE_CONVERT_POLL
+#define ONEWIRE_CONVERT_POLL		10
+#endif
+
+#define ONEWIRE_CONVERT_TIMEOUT		0xFFFF	// wireWaitConvert() gave up
+
+// Estimated I2C cost in us of moving one 1-Wire byte through the bridge
+#define ONEWIRE_TIME_BYTE_I2C		1000
+
+// Family driver table, expanded into the PROGMEM table and the compile-time family lookup
+//	family	flags							scratchpad	convert	memory	config
+#define ONEWIRE_DRIVER_TABLE(X) \
+	X(0x10,	ONEWIRE_DRIVER_TEMPERATURE,		9,			750,	0,		0)	/* DS18S20 */ \
+	X(0x22,	ONEWIRE_DRIVER_TEMPERATURE,		9,			750,	0,		4)	/* DS1822 */ \
+	X(0x28,	ONEWIRE_DRIVER_TEMPERATURE,		9,			750,	0,		4)	/* DS18B20 */ \
+	X(0x3B,	ONEWIRE_DRIVER_TEMPERATURE,		9,			100,	0,		0)	/* MAX31850 */ \
+	X(0x42,	ONEWIRE_DRIVER_TEMPERATURE,		9,			750,	0,		4)	/* DS28EA00 */ \
+	X(0x26,	ONEWIRE_DRIVER_ADC,				0,			10,		40,		0)	/* DS2438 */ \
+	X(0x1D,	ONEWIRE_DRIVER_MEMORY,			0,			0,		512,	0)	/* DS2423 */ \
+	X(0x29,	ONEWIRE_DRIVER_SWITCH,			0,			0,		0,		0)	/* DS2408 */ \
+	X(0x3A,	ONEWIRE_DRIVER_SWITCH,			0,			0,		0,		0)	/* DS2413 */ \
+	X(0x12,	ONEWIRE_DRIVER_SWITCH,			0,			0,		0,		0)	/* DS2406 */ \
+	X(0x2D,	ONEWIRE_DRIVER_MEMORY,			0,			0,		128,	0)	/* DS2431 */ \
+	X(0x23,	ONEWIRE_DRIVER_MEMORY,			0,			0,		512,	0)	/* DS2433 */
+
+// Static per-family driver description, kept in PROGMEM
+struct OneWireDriver
+{
+	uint8_t family;			// ROM family code
+	uint8_t flags;			// ONEWIRE_DRIVER_*
+	uint8_t scratchpadLen;	// Read Scratchpad length including CRC8, 0 if none
+	uint16_t convertTime;	// worst case conversion time in ms, 0 if none
+	uint16_t memorySize;	// user memory in bytes, 0 if none
+	uint8_t configByte;		// scratchpad byte with the R1:R0 resolution bits, 0 if fixed
+};
+
+// Bus usage counters, cleared by clearStats()
+struct OneWireStats
+{
+	uint32_t transactions;	// I2C transactions with the bridge
+	uint32_t polls;			// status polls that found the bridge busy
+	uint32_t busyTime;		// expected 1-Wire busy time of issued commands in us
+	uint16_t timeouts;		// waits that gave up on the busy bit
+	uint16_t crcErrors;		// scratchpad reads that failed CRC8
+	uint32_t readings;		// valid readings taken by acquire()
+	uint32_t cycles;		// acquire() cycles
+	uint32_t cycleTime;		// total time spent in acquire() in ms
+	uint32_t muxSwitches;	// I2C mux channel changes made for this bridge
+	uint32_t shedCycles;	// acquire() cycles run with load shedding active
+	uint16_t shedReads;		// reads left out or CRC re-reads dropped by load shedding
+	uint16_t shorts;		// resets that found the line shorted
+};
+
+// Registry entry for a device found on the bus
+struct OneWireDevice
+{
+	uint8_t rom[8];
+	uint8_t driver;			// index into the driver table or ONEWIRE_NO_DRIVER
+	uint8_t flags;			// ONEWIRE_DEVICE_*
+	uint8_t resolution;		// conversion resolution in bits, 0 if fixed
+	uint8_t position;		// physical position from chain discovery, 0 if unknown
+	uint8_t skip;			// acquire() cycles left before the device is read again
+	uint8_t faults;			// MAX31850_FAULT_* of the last read, 0 if it was good
+	int16_t raw;			// last good temperature register value
+};
+
+#define ONEWIRE_DRIVER_FAMILY(family, flags, scratchpad, convert, memory, config)	family,
+constexpr uint8_t oneWireDriverFamilies[] = { ONEWIRE_DRIVER_TABLE(ONEWIRE_DRIVER_FAMILY) };
+#undef ONEWIRE_DRIVER_FAMILY
+
+// Never defined: a ROM literal that fails validation calls it, which is a compile error
+// in a constexpr declaration and a link error anywhere else
+uint8_t oneWireInvalidRomLiteral();
+
+// ROM code known at build time, for installations with a fixed set of devices. Built
+// from 16 hex digits in bus order (family code first, CRC last) as printed by the
+// Scan_1Wire_Bus example; a bad digit or CRC stops the build, and the family driver is
+// bound by the compiler. Tables go in flash and are loaded with OneWire::loadDevices():
+//	constexpr OneWireRom sensors[] PROGMEM = { "28FF4C6A7216030F", "28FF0B1E6C16042C" };
+struct OneWireRom
+{
+	uint8_t rom[8];
+	uint8_t driver;			// driver table index or ONEWIRE_NO_DRIVER
+
+	constexpr OneWireRom(const char (&hex)[17]) :
+		rom{ hexByte(hex, 0), hexByte(hex, 1), hexByte(hex, 2), hexByte(hex, 3),
+			hexByte(hex, 4), hexByte(hex, 5), hexByte(hex, 6), checkCrc(hex) },
+		driver(driverFor(hexByte(hex, 0))) {}
+
+	static constexpr uint8_t driverFor(uint8_t family, uint8_t i = 0)
+	{
+		return i >= sizeof(oneWireDriverFamilies) ? ONEWIRE_NO_DRIVER :
+			oneWireDriverFamilies[i] == family ? i : driverFor(family, i + 1);
+	}
+
+	static constexpr uint8_t hexDigit(char c)
+	{
+		return c >= '0' && c <= '9' ? c - '0' : c >= 'A' && c <= 'F' ? c - 'A' + 10 :
+			c >= 'a' && c <= 'f' ? c - 'a' + 10 : oneWireInvalidRomLiteral();
+	}
+
+	static constexpr uint8_t hexByte(const char *hex, uint8_t i)
+	{
+		return (hexDigit(hex[2 * i]) << 4) | hexDigit(hex[2 * i + 1]);
+	}
+
+	// Dallas CRC8 over the first n bytes, one bit per step
+	static constexpr uint8_t crcBits(uint8_t crc, uint8_t data, uint8_t bits)
+	{
+		return bits ? crcBits(((crc ^ data) & 1) ? (crc >> 1) ^ 0x8C : crc >> 1, data >> 1, bits - 1) : crc;
+	}
+
+	static constexpr uint8_t crc(const char *hex, uint8_t n)
+	{
+		return n ? crcBits(crc(hex, n - 1), hexByte(hex, n - 1), 8) : 0;
+	}
+
+	static constexpr uint8_t checkCrc(const char *hex)
+	{
+		return crc(hex, 7) == hexByte(hex, 7) ? hexByte(hex, 7) : oneWireInvalidRomLiteral();
+	}
+};
+
+#define ONEWIRE_ROM_COUNT(table)	(sizeof(table) / sizeof((table)[0]))
+
+class DS2480B;
 
 class OneWire
 {
 public:
 	OneWire();
 	OneWire(uint8_t address);
+	OneWire(uint8_t address, uint8_t muxAddress, uint8_t muxChannel);
+	OneWire(DS2480B &master);
         void idle(void (*)());
+	void idleBudget(void (*)(uint32_t us));
+	void preempt(bool (*)());
+	bool preemptPoint();
+	void readingHook(void (*)(const OneWireDevice *device));
+	void wireDelay(uint16_t ms);
 	uint8_t getAddress();
+	uint16_t getMuxPath();
 	uint8_t getError();
 	uint8_t checkPresence();
 
@@ -56,12 +340,18 @@ public:
 	uint8_t readStatus();
 	uint8_t readData();
 	uint8_t waitOnBusy();
+	void burstPoll(bool on);
 	
        uint8_t busyWait(bool setReadPtr=false);///
        uint8_t wireReadStatus(bool setPtr);///
 
 	uint8_t readConfig();
 	void writeConfig(uint8_t config);
+	bool selectChannel(uint8_t channel);
+	uint8_t getChannel();
+	void bindChannel(uint8_t channel);
+	bool quarantined();
+	uint32_t quarantineDue();
 	void setStrongPullup();
 	void setActivePullup();
 	void clearStrongPullup();
@@ -74,8 +364,48 @@ public:
 	void wireSelect(const uint8_t rom[8]);
 	void wireResetSearch();
 	int8_t wireSearch(uint8_t *address);
+	void wireWriteBlock(const uint8_t *buf, uint8_t count);
+	void wireReadBlock(uint8_t *buf, uint8_t count);
+	uint16_t wireWaitConvert(uint16_t timeout);
+
+	// device registry and family drivers
+	uint8_t wireEnumerate();
+	uint8_t getDeviceCount();
+	OneWireDevice *getDevice(uint8_t index);
+	int8_t findDevice(const uint8_t rom[8]);
+	uint8_t loadDevices(const OneWireRom *table, uint8_t count);
+	static uint8_t findDriver(uint8_t family);
+	static bool getDriver(uint8_t driver, OneWireDriver *out);
+	bool readScratchpad(const uint8_t rom[8], uint8_t *buf);
+	bool storeReading(OneWireDevice *device, const uint8_t *scratchpad);
+	uint8_t wireChainDiscover();
+	bool readMAX31850(const uint8_t rom[8], MAX31850Reading *out);
+	static void decodeMAX31850(const uint8_t *scratchpad, MAX31850Reading *out);
+
+	// temperature acquisition over the registry
+	uint8_t acquire();
+	bool acquireStart();
+	bool acquirePoll();
+	uint32_t acquireDue();
+	uint8_t acquireResult();
+	bool acquireBusy();
+	bool busFree();
+	uint8_t getAcquireMode();
+	const OneWireStats *getStats();
+	void clearStats();
+	void setShedLevel(uint8_t level);
+	uint8_t getShedLevel();
+	uint16_t conversionTime(const OneWireDevice *device);
+	uint16_t measuredConversion();
+	static float rawToCelsius(uint8_t family, int16_t raw);
+
+	// checkpoint/restore for fast wake from deep sleep
+	uint16_t saveState(uint8_t *buf, uint16_t size);
+	bool restoreState(const uint8_t *buf, uint16_t len);
 
 	// emulation of original OneWire library
+	void searchCache(uint32_t maxAge);
+	void invalidateSearchCache();
 	void reset_search();
 	uint8_t search(uint8_t *newAddr);
 	static uint8_t crc8(const uint8_t *addr, uint8_t len);
@@ -91,12 +421,34 @@ public:
         static uint16_t crc16(const uint8_t* input, uint16_t len, uint16_t crc=0);
         static bool check_crc16(const uint8_t* input, uint16_t len, const uint8_t* inverted_crc, uint16_t crc = 0);
 private:
+	void init();
+	void selectPath();
+	void selectMux();
+	void ensureChannel();
+	void noteShort(bool shorted);
 	void begin();
 	uint8_t end();
+	int8_t searchTriplets(int8_t *lastZero);
 	void writeByte(uint8_t);
+	bool request(uint8_t count);
 	uint8_t readByte();
+	uint8_t pollStatus();
+	void noteBridgeReset();
 	uint8_t APU;
+	uint8_t mConfig;		// shadow of the config register
+	uint8_t mChannel;		// selected DS2482-800 channel
+	uint8_t mPointer;		// register the read pointer selects, DS2482_POINTER_UNKNOWN if not known
+	uint8_t mBurst;
 	uint8_t mAddress;
+	uint8_t mMuxAddress;	// ONEWIRE_MUX_NONE if the bridge is on the main bus
+	uint8_t mMuxChannel;
+	static uint8_t sMuxAddress;	// mux with a channel open, shared by all bridges on Wire
+	static uint8_t sMuxChannel;
+	uint8_t mBoundChannel;	// DS2482-800 channel this object drives, ONEWIRE_CHANNEL_NONE if any
+	static OneWire *sChannelOwner[ONEWIRE_CHANNEL_OWNERS];	// bound object whose channel each bridge has selected
+	OneWire **channelOwner();
+	uint32_t mQuarantine;	// current probe interval in ms, 0 if the segment is healthy
+	unsigned long mQuarantineStart;
 	uint8_t mError;
 
 	uint8_t searchAddress[8];
@@ -107,7 +459,71 @@ private:
 	uint8_t searchLastDisrepancy;///
 	uint8_t searchExhausted;///
 
+	int8_t addDevice(const uint8_t rom[8]);
+	void finishSearchPass();
+	bool chainCommand(uint8_t command);
+	uint8_t notePresence(uint8_t present);
+	bool searchCacheValid();
+	OneWireDevice mDevices[ONEWIRE_MAX_DEVICES];
+	uint8_t mDeviceCount;
+
+	uint32_t mCacheMaxAge;
+	unsigned long mCacheTime;
+	uint8_t mCacheValid;
+	uint8_t mCacheReplay;
+	uint8_t mCacheIndex;
+	uint8_t mSearchOverflow;
+	uint8_t mLastPresence;
+
+	void probeDevice(OneWireDevice *device);
+	void shedResolution(OneWireDevice *device, bool shed);
+	bool readDevice(OneWireDevice *device, uint8_t *buf);
+	bool isTemperature(const OneWireDevice *device);
+	static bool scratchpadValid(const uint8_t *buf, uint8_t len);
+	uint8_t prepareAcquire(uint16_t *convert);
+	void convertGroup(uint8_t group);
+	bool readGroup(uint8_t group);
+	bool readStep(OneWireDevice *device);
+	void finishRead(OneWireDevice *device, const uint8_t *buf);
+	bool stepReady();
+	void issue(uint8_t command, uint8_t data, uint8_t slots);
+	uint32_t groupDue(uint8_t group);
+	void finishCycle();
+	OneWireStats mStats;
+	uint8_t mAcquireMode;
+	uint8_t mShedLevel;
+	uint8_t mPhase;
+	uint8_t mCycleValid;
+	uint16_t mConvertTime;
+	unsigned long mCycleStart;
+	uint8_t mGroupPending;
+	unsigned long mGroupStart[2];
+	uint8_t mConvertPoll;	// broadcast conversion end is sampled with read slots, 2 once seen
+	unsigned long mConvertSample;
+	uint16_t mMeasuredConvert;
+	uint8_t mReadIndex;		// registry index of the device being read
+	uint8_t mReadN;			// temperature devices passed, for the group split
+	uint8_t mReadOp;		// 1-Wire operations issued for the current device
+	uint8_t mReadLen;
+	uint8_t mReadRetry;
+	uint8_t mReadBuf[9];
+	uint8_t mStepStatus;	// status of the last operation stepReady() saw finish
+
 	void (*_idle)();
+	void (*_idleBudget)(uint32_t us);
+
+	bool (*_preempt)();
+	uint8_t mPreempting;
+
+	void (*_reading)(const OneWireDevice *device);
+
+	DS2480B *mSerial;		// serial line driver used instead of a DS2482, if set
+
+	void startBusy(uint8_t slots);
+	uint32_t busyRemaining();
+	uint8_t mOverdrive;
+	uint16_t mBusyTime;
+	uint32_t mBusyStart;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include <Arduino.h>
+#include "OneWireBatch.h"
+
+OneWireBatch::OneWireBatch(OneWire &bus) : mBus(bus)
+{
+	clear();
+}
+
+void OneWireBatch::clear()
+{
+	mCount = 0;
+}
+
+uint8_t OneWireBatch::count()
+{
+	return mCount;
+}
+
+bool OneWireBatch::full()
+{
+	return mCount >= ONEWIRE_BATCH_SIZE;
+}
+
+// The first count() entries of each column are valid
+const OneWireColumns *OneWireBatch::columns()
+{
+	return &mColumns;
+}
+
+bool OneWireBatch::add(const OneWireDevice *device)
+{
+	return add(device, millis());
+}
+
+// Appends a device's current reading; false once the batch is full
+bool OneWireBatch::add(const OneWireDevice *device, uint32_t time)
+{
+	if (full())
+		return false;
+
+	mColumns.time[mCount] = time;
+	mColumns.value[mCount] = OneWire::rawToCelsius(device->rom[0], device->raw);
+	mColumns.raw[mCount] = device->raw;
+	mColumns.device[mCount] = device - mBus.getDevice(0);
+	mColumns.flags[mCount] = device->flags;
+	mCount++;
+	return true;
+}
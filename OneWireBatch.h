@@ -0,0 +1,44 @@
+#ifndef __ONEWIREBATCH_H__
+#define __ONEWIREBATCH_H__
+
+#include <inttypes.h>
+#include "DS2482_OneWire.h"
+
+// Readings per batch
+#ifndef ONEWIRE_BATCH_SIZE
+#define ONEWIRE_BATCH_SIZE			32
+#endif
+
+// Readings stored column by column: entry i of every array belongs to reading i. Each
+// column is a contiguous array of one fixed-width little-endian type, ordered by width,
+// so it can be written out or handed to a consumer as it is.
+struct OneWireColumns
+{
+	uint32_t time[ONEWIRE_BATCH_SIZE];		// millis() when the reading was taken
+	float value[ONEWIRE_BATCH_SIZE];		// degrees C
+	int16_t raw[ONEWIRE_BATCH_SIZE];		// temperature register value
+	uint8_t device[ONEWIRE_BATCH_SIZE];		// registry index on the bus
+	uint8_t flags[ONEWIRE_BATCH_SIZE];		// ONEWIRE_DEVICE_* of the device at the time
+};
+
+// Collects readings from the reading hook of one bus into fixed-size columnar batches,
+// so a consumer handles a whole batch per call instead of one device at a time.
+// Registry indexes stay valid until the bus is enumerated again.
+class OneWireBatch
+{
+public:
+	OneWireBatch(OneWire &bus);
+	bool add(const OneWireDevice *device);
+	bool add(const OneWireDevice *device, uint32_t time);
+	uint8_t count();
+	bool full();
+	const OneWireColumns *columns();
+	void clear();
+
+private:
+	OneWire &mBus;
+	OneWireColumns mColumns;
+	uint8_t mCount;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include <Arduino.h>
+#include "OneWireHistory.h"
+
+OneWireHistory::OneWireHistory() : mRomTable(mRoms, mHead, ONEWIRE_HISTORY_ROMS)
+{
+	clear();
+}
+
+void OneWireHistory::clear()
+{
+	mWritten = 0;
+	mRomTable.clear();
+}
+
+// Number of readings currently held
+uint16_t OneWireHistory::count()
+{
+	return mWritten < ONEWIRE_HISTORY_SIZE ? mWritten : ONEWIRE_HISTORY_SIZE;
+}
+
+const uint8_t *OneWireHistory::getRom(uint8_t slot)
+{
+	return mRomTable.get(slot);
+}
+
+// True while the record with this sequence number has not been overwritten
+bool OneWireHistory::inRing(uint32_t seq)
+{
+	return seq < mWritten && mWritten - seq <= ONEWIRE_HISTORY_SIZE;
+}
+
+// Takes a free ROM slot, or the one whose newest reading is oldest. Records left
+// behind by the previous owner stay in the ring but are no longer reachable.
+uint8_t OneWireHistory::claimRom(const uint8_t rom[8])
+{
+	uint8_t slot = mRomTable.claim(rom);
+
+	mHead[slot] = 0xFFFFFFFFUL;
+	return slot;
+}
+
+// Stores a device's current reading. Meant to be called from the readingHook() of the
+// bus, which only reports CRC checked values.
+bool OneWireHistory::add(const OneWireDevice *device)
+{
+	return add(device->rom, device->raw, millis());
+}
+
+bool OneWireHistory::add(const uint8_t rom[8], int16_t raw, uint32_t time)
+{
+	uint8_t slot = mRomTable.find(rom);
+
+	if (slot == ONEWIRE_HISTORY_NONE)
+		slot = claimRom(rom);
+
+	OneWireRecord *record = &mRecords[mWritten % ONEWIRE_HISTORY_SIZE];
+	record->time = time;
+	record->raw = raw;
+	record->rom = slot;
+	record->back = 0;
+	// a link as long as the ring points at the record this one replaces
+	if (inRing(mHead[slot]) && mWritten - mHead[slot] < ONEWIRE_HISTORY_SIZE)
+		record->back = mWritten - mHead[slot];
+
+	mHead[slot] = mWritten++;
+	return true;
+}
+
+bool OneWireHistory::latest(const uint8_t rom[8], OneWireRecord *out)
+{
+	uint8_t slot = mRomTable.find(rom);
+
+	if (slot == ONEWIRE_HISTORY_NONE || !inRing(mHead[slot]))
+		return false;
+	*out = mRecords[mHead[slot] % ONEWIRE_HISTORY_SIZE];
+	return true;
+}
+
+// Copies up to max readings of a ROM with from <= time <= to into out, oldest first,
+// and returns how many were copied. If there are more, the newest ones are kept.
+uint16_t OneWireHistory::query(const uint8_t rom[8], uint32_t from, uint32_t to, OneWireRecord *out, uint16_t max)
+{
+	uint8_t slot = mRomTable.find(rom);
+	uint16_t n = 0;
+
+	if (slot == ONEWIRE_HISTORY_NONE)
+		return 0;
+
+	uint32_t seq = mHead[slot];
+	while (n < max && inRing(seq))
+	{
+		OneWireRecord *record = &mRecords[seq % ONEWIRE_HISTORY_SIZE];
+		if (record->time < from)
+			break;
+		if (record->time <= to)
+			out[n++] = *record;
+		if (!record->back)
+			break;
+		seq -= record->back;
+	}
+
+	// the chain runs newest first
+	for (uint16_t i = 0; i < n / 2; i++)
+	{
+		OneWireRecord swap = out[i];
+		out[i] = out[n - 1 - i];
+		out[n - 1 - i] = swap;
+	}
+	return n;
+}
@@ -0,0 +1,69 @@
+#ifndef __ONEWIREHISTORY_H__
+#define __ONEWIREHISTORY_H__
+
+#include <inttypes.h>
+#include "DS2482_OneWire.h"
+#include "OneWireRomTable.h"
+
+// Readings kept in RAM; the oldest are overwritten once the ring is full. The default
+// leaves room for the sketch on 2 KB AVR parts such as the ATmega328.
+#ifndef ONEWIRE_HISTORY_SIZE
+#if defined(RAMEND) && RAMEND < 0x1000
+#define ONEWIRE_HISTORY_SIZE		32
+#elif defined(RAMEND)
+#define ONEWIRE_HISTORY_SIZE		128
+#else
+#define ONEWIRE_HISTORY_SIZE		256
+#endif
+#endif
+
+// Back-links span at most the ring, so they only need a byte up to 256 records
+#if ONEWIRE_HISTORY_SIZE > 256
+typedef uint16_t OneWireHistoryLink;
+#else
+typedef uint8_t OneWireHistoryLink;
+#endif
+
+// Distinct ROMs tracked; the least recently updated one gives up its slot
+#ifndef ONEWIRE_HISTORY_ROMS
+#define ONEWIRE_HISTORY_ROMS		ONEWIRE_MAX_DEVICES
+#endif
+
+#define ONEWIRE_HISTORY_NONE		ONEWIRE_ROM_NONE
+
+// One stored reading, 8 bytes with byte back-links
+struct OneWireRecord
+{
+	uint32_t time;			// timestamp passed to add(), millis() by default
+	int16_t raw;			// temperature register value
+	uint8_t rom;			// ROM slot, see getRom()
+	OneWireHistoryLink back;	// distance in records to the previous reading of the same ROM, 0 if none
+};
+
+// Ring of fixed-size readings with a back-link chain per ROM. A range query starts at
+// the ROM's newest reading and follows the chain, so it only touches that ROM's records
+// no matter how many other sensors share the ring.
+class OneWireHistory
+{
+public:
+	OneWireHistory();
+	void clear();
+	bool add(const OneWireDevice *device);
+	bool add(const uint8_t rom[8], int16_t raw, uint32_t time);
+	bool latest(const uint8_t rom[8], OneWireRecord *out);
+	uint16_t query(const uint8_t rom[8], uint32_t from, uint32_t to, OneWireRecord *out, uint16_t max);
+	uint16_t count();
+	const uint8_t *getRom(uint8_t slot);
+
+private:
+	uint8_t claimRom(const uint8_t rom[8]);
+	bool inRing(uint32_t seq);
+
+	OneWireRecord mRecords[ONEWIRE_HISTORY_SIZE];
+	uint32_t mWritten;		// records ever added; the next one goes to mWritten % size
+	uint8_t mRoms[ONEWIRE_HISTORY_ROMS][8];
+	uint32_t mHead[ONEWIRE_HISTORY_ROMS];	// sequence number of each ROM's newest record
+	OneWireRomTable mRomTable;
+};
+
+#endif
@@ -0,0 +1,208 @@
+#include <Arduino.h>
+#include "OneWireJobs.h"
+#ifdef __AVR__
+#include <util/atomic.h>
+#endif
+
+#define ONEWIRE_JOB_MASK			(ONEWIRE_JOB_QUEUE_SIZE - 1)
+
+// AVR has no compare-and-swap, and avr-gcc may turn the __atomic builtins into library
+// calls. There the queue is updated with interrupts off, where plain byte accesses do.
+#ifdef __AVR__
+#define ONEWIRE_JOB_LOAD(p)			(*(p))
+#define ONEWIRE_JOB_STORE(p, v)		(*(p) = (v))
+#else
+#define ONEWIRE_JOB_LOAD(p)			__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define ONEWIRE_JOB_STORE(p, v)		__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#endif
+
+OneWireJobQueue::OneWireJobQueue(OneWire &bus) : mBus(bus)
+{
+	for (uint8_t i = 0; i < ONEWIRE_JOB_QUEUE_SIZE; i++)
+		mCells[i].sequence = i;
+	mTail = 0;
+	mHead = 0;
+	mCount = 0;
+	mIndex = 0;
+	mConverting = 0;
+}
+
+// Each cell's sequence says whose turn it is: equal to the claiming position when free
+// for a producer, one past it when filled for the consumer. Producers race only on the
+// tail with a compare-and-swap; on AVR, interrupts are off while the cell is filled.
+// Returns false if the queue is full.
+bool OneWireJobQueue::submit(const OneWireJob &job)
+{
+#ifdef __AVR__
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Cell *cell = &mCells[mTail & ONEWIRE_JOB_MASK];
+		if (cell->sequence != mTail)
+			return false;
+		if (job.status)
+			*job.status = ONEWIRE_JOB_PENDING;
+		cell->job = job;
+		cell->sequence = ++mTail;
+	}
+	return true;
+#else
+	uint8_t pos = __atomic_load_n(&mTail, __ATOMIC_RELAXED);
+	Cell *cell;
+
+	for (;;)
+	{
+		cell = &mCells[pos & ONEWIRE_JOB_MASK];
+		int8_t diff = (int8_t)(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - pos);
+		if (diff == 0)
+		{
+			if (__atomic_compare_exchange_n(&mTail, &pos, (uint8_t)(pos + 1), true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if (diff < 0)
+			return false;
+		else
+			pos = __atomic_load_n(&mTail, __ATOMIC_RELAXED);
+	}
+
+	if (job.status)
+		*job.status = ONEWIRE_JOB_PENDING;
+	cell->job = job;
+	__atomic_store_n(&cell->sequence, (uint8_t)(pos + 1), __ATOMIC_RELEASE);
+	return true;
+#endif
+}
+
+bool OneWireJobQueue::take(OneWireJob *job)
+{
+	Cell *cell = &mCells[mHead & ONEWIRE_JOB_MASK];
+
+#ifdef __AVR__
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+	{
+		if ((int8_t)(ONEWIRE_JOB_LOAD(&cell->sequence) - (uint8_t)(mHead + 1)) < 0)
+			return false;
+		*job = cell->job;
+		ONEWIRE_JOB_STORE(&cell->sequence, (uint8_t)(mHead + ONEWIRE_JOB_QUEUE_SIZE));
+	}
+	mHead++;
+	return true;
+}
+
+void OneWireJobQueue::complete(const OneWireJob *job, uint8_t result)
+{
+	if (job->status)
+		*job->status = result;
+	if (job->done)
+		job->done(job, result);
+}
+
+// Runs mBatch[index] unless an earlier job in the batch already did the same work since
+// the last convert, in which case its result is reused. Returns the job's result, or
+// ONEWIRE_JOB_PENDING once a convert has started an acquisition cycle.
+uint8_t OneWireJobQueue::run(uint8_t index)
+{
+	OneWireJob *job = &mBatch[index];
+
+	// look back to the last convert for an identical job; every convert in the batch
+	// is served by the first one
+	for (uint8_t i = index; i-- > 0;)
+	{
+		OneWireJob *prev = &mBatch[i];
+		if (prev->type == job->type && (job->type != ONEWIRE_JOB_READ || prev->device == job->device))
+		{
+			if (job->type != ONEWIRE_JOB_WRITE)
+				return mResults[i];
+		}
+		if (prev->type == ONEWIRE_JOB_CONVERT)
+			break;
+	}
+
+	switch (job->type)
+	{
+	case ONEWIRE_JOB_CONVERT:
+		// the bridge's own non-blocking cycle, driven by later process() calls
+		if (!mBus.acquireStart())
+			return 0;
+		mConverting = 1;
+		return ONEWIRE_JOB_PENDING;
+	case ONEWIRE_JOB_READ:
+	{
+		uint8_t buf[9];
+		OneWireDevice *device = mBus.getDevice(job->device);
+		if (!device || !mBus.readScratchpad(device->rom, buf))
+			return 0;
+		return mBus.storeReading(device, buf);
+	}
+	case ONEWIRE_JOB_WRITE:
+	{
+		uint8_t written = job->memory->write(job->address, job->data, job->count);
+		// writes to the same device share one flush, done by the last of them, and all
+		// of them report its result
+		for (uint8_t i = index + 1; i < mCount; i++)
+			if (mBatch[i].type == ONEWIRE_JOB_WRITE && mBatch[i].memory == job->memory)
+				return written ? ONEWIRE_JOB_PENDING : 0;
+		uint8_t flushed = job->memory->flush();
+		for (uint8_t i = 0; i < index; i++)
+			if (mBatch[i].type == ONEWIRE_JOB_WRITE && mBatch[i].memory == job->memory && mResults[i] == ONEWIRE_JOB_PENDING)
+				mResults[i] = flushed;
+		return written && flushed;
+	}
+	case ONEWIRE_JOB_RESCAN:
+		return mBus.wireEnumerate() > 0;
+	}
+	return 0;
+}
+
+// Moves the batch on by one job. Returns false while a convert is still running.
+bool OneWireJobQueue::step()
+{
+	if (!mConverting)
+		mResults[mIndex] = run(mIndex);
+	if (mConverting)
+	{
+		if (!mBus.acquirePoll())
+			return false;
+		mConverting = 0;
+		mResults[mIndex] = mBus.acquireResult() > 0;
+	}
+	mIndex++;
+	return true;
+}
+
+// Drains the queue in batches and completes every job. Called by the single owner of
+// the bridge; never waits on a conversion, so while one runs it returns and due() says
+// when to call again. A rescan ends its batch, since it can renumber the registry the
+// jobs behind it refer to. Returns the number of jobs completed.
+uint8_t OneWireJobQueue::process()
+{
+	uint8_t done = 0;
+
+	for (;;)
+	{
+		if (mIndex == mCount)
+		{
+			for (uint8_t i = 0; i < mCount; i++)
+				complete(&mBatch[i], mResults[i]);
+			done += mCount;
+
+			for (mCount = 0, mIndex = 0; mCount < ONEWIRE_JOB_BATCH && take(&mBatch[mCount]);)
+			{
+				// unknown job types fail
+				mResults[mCount] = 0;
+				if (mBatch[mCount++].type == ONEWIRE_JOB_RESCAN)
+					break;
+			}
+			if (!mCount)
+				return done;
+		}
+		if (!step())
+			return done;
+	}
+}
+
+// Time in ms until process() has more to do for a running convert, 0 otherwise
+uint32_t OneWireJobQueue::due()
+{
+	return mConverting ? mBus.acquireDue() : 0;
+}
@@ -0,0 +1,77 @@
+#ifndef __ONEWIREJOBS_H__
+#define __ONEWIREJOBS_H__
+
+#include <inttypes.h>
+#include "DS2482_OneWire.h"
+#include "OneWireMemory.h"
+
+// Queue depth per bridge, a power of two no larger than 64
+#ifndef ONEWIRE_JOB_QUEUE_SIZE
+#define ONEWIRE_JOB_QUEUE_SIZE		8
+#endif
+
+// Jobs the worker drains in one batch, and so can merge
+#define ONEWIRE_JOB_BATCH			ONEWIRE_JOB_QUEUE_SIZE
+
+// Job types
+#define ONEWIRE_JOB_CONVERT			1		// acquisition cycle over the registry, as acquireStart()
+#define ONEWIRE_JOB_READ			2		// read a registry device's scratchpad into the registry
+#define ONEWIRE_JOB_WRITE			3		// write bytes through a OneWireMemory cache
+#define ONEWIRE_JOB_RESCAN			4		// wireEnumerate()
+
+// Value of *status while a job is queued or running
+#define ONEWIRE_JOB_PENDING			0xFF
+
+struct OneWireJob;
+typedef void (*OneWireJobCallback)(const OneWireJob *job, uint8_t result);
+
+struct OneWireJob
+{
+	uint8_t type;				// ONEWIRE_JOB_*
+	uint8_t device;				// registry index for ONEWIRE_JOB_READ
+	OneWireMemory *memory;		// target of ONEWIRE_JOB_WRITE
+	uint16_t address;
+	const uint8_t *data;		// must stay valid until the job completes
+	uint8_t count;
+	volatile uint8_t *status;	// optional: set to the result on completion
+	OneWireJobCallback done;	// optional: called from process() on completion
+	void *context;
+};
+
+// Bounded multi-producer/single-consumer job queue in front of one bridge. submit() is
+// lock-free (on AVR it briefly disables interrupts instead) and never touches the bus,
+// so it can be called from any task or interrupt. The bridge owner calls process(),
+// which drains the queue and merges what it can: one acquisition cycle serves all
+// queued converts, and repeated reads of the same device are done once.
+class OneWireJobQueue
+{
+public:
+	OneWireJobQueue(OneWire &bus);
+	bool submit(const OneWireJob &job);
+	uint8_t process();
+	uint32_t due();
+
+private:
+	struct Cell
+	{
+		uint8_t sequence;
+		OneWireJob job;
+	};
+
+	bool take(OneWireJob *job);
+	uint8_t run(uint8_t index);
+	bool step();
+	void complete(const OneWireJob *job, uint8_t result);
+
+	OneWire &mBus;
+	Cell mCells[ONEWIRE_JOB_QUEUE_SIZE];
+	uint8_t mTail;				// next slot producers claim
+	uint8_t mHead;				// next slot the consumer takes
+	OneWireJob mBatch[ONEWIRE_JOB_BATCH];	// jobs taken, completed together once all have run
+	uint8_t mResults[ONEWIRE_JOB_BATCH];
+	uint8_t mCount;
+	uint8_t mIndex;				// next job of the batch to run
+	uint8_t mConverting;		// mBatch[mIndex] is waiting on an acquisition cycle
+};
+
+#endif
@@ -0,0 +1,259 @@
+#include <Arduino.h>
+#include "OneWireMemory.h"
+
+OneWireMemory::OneWireMemory(OneWire &bus, const uint8_t rom[8]) : mBus(bus)
+{
+	OneWireDriver driver;
+
+	memcpy(mRom, rom, 8);
+	mSize = 0;
+	if (OneWire::getDriver(OneWire::findDriver(rom[0]), &driver))
+		mSize = driver.memorySize;
+	invalidate();
+}
+
+uint16_t OneWireMemory::size()
+{
+	return mSize;
+}
+
+bool OneWireMemory::rowFlag(const uint8_t *flags, uint8_t row)
+{
+	return flags[row >> 3] & (1 << (row & 7));
+}
+
+void OneWireMemory::setRowFlag(uint8_t *flags, uint8_t row, bool on)
+{
+	if (on)
+		flags[row >> 3] |= 1 << (row & 7);
+	else
+		flags[row >> 3] &= ~(1 << (row & 7));
+}
+
+// Drops every cached row, including unflushed writes
+void OneWireMemory::invalidate()
+{
+	memset(mValid, 0, sizeof(mValid));
+	memset(mDirty, 0, sizeof(mDirty));
+	mCountersValid = 0;
+}
+
+// Read Memory from any address runs on to the end of the device. Between 32 byte pages
+// the bus may be preempted, after which the read restarts at the next address.
+bool OneWireMemory::readMemory(uint16_t address, uint8_t *buf, uint16_t count)
+{
+	bool select = true;
+
+	while (count)
+	{
+		if (select)
+		{
+			if (!mBus.wireReset())
+				return false;
+			mBus.wireSelect(mRom);
+			mBus.wireWriteByte(WIRE_COMMAND_READ_MEMORY);
+			mBus.wireWriteByte(address & 0xFF);
+			mBus.wireWriteByte(address >> 8);
+		}
+
+		uint8_t n = 32 - (address & 31);
+		if (n > count)
+			n = count;
+		mBus.wireReadBlock(buf, n);
+		address += n;
+		buf += n;
+		count -= n;
+
+		select = count && mBus.preemptPoint();
+	}
+	return true;
+}
+
+// Fills a run of cache rows with one Read Memory
+bool OneWireMemory::fetch(uint8_t row, uint8_t count)
+{
+	if (!readMemory(row * ONEWIRE_MEMORY_ROW, mCache + row * ONEWIRE_MEMORY_ROW, count * ONEWIRE_MEMORY_ROW))
+		return false;
+	for (uint8_t i = row; i < row + count; i++)
+		setRowFlag(mValid, i, true);
+	return true;
+}
+
+bool OneWireMemory::read(uint16_t address, uint8_t *buf, uint16_t count)
+{
+	if ((uint32_t)address + count > mSize)
+		return false;
+
+	while (count && address < ONEWIRE_MEMORY_CACHE_SIZE)
+	{
+		uint8_t row = address / ONEWIRE_MEMORY_ROW;
+		if (!rowFlag(mValid, row))
+		{
+			// fetch the whole run of missing rows the request covers
+			uint8_t last = (address + count - 1) / ONEWIRE_MEMORY_ROW;
+			uint8_t end = row;
+			if (last >= ONEWIRE_MEMORY_ROWS)
+				last = ONEWIRE_MEMORY_ROWS - 1;
+			while (end < last && !rowFlag(mValid, end + 1))
+				end++;
+			if (!fetch(row, end - row + 1))
+				return false;
+		}
+		*buf++ = mCache[address++];
+		count--;
+	}
+
+	if (count)
+		return readMemory(address, buf, count);
+	return true;
+}
+
+bool OneWireMemory::write(uint16_t address, const uint8_t *buf, uint16_t count)
+{
+	uint8_t row[ONEWIRE_MEMORY_ROW];
+
+	if ((uint32_t)address + count > mSize)
+		return false;
+
+	while (count)
+	{
+		uint16_t base = address & ~(ONEWIRE_MEMORY_ROW - 1);
+		uint8_t offset = address - base;
+		uint8_t n = ONEWIRE_MEMORY_ROW - offset;
+		if (n > count)
+			n = count;
+
+		if (base < ONEWIRE_MEMORY_CACHE_SIZE)
+		{
+			uint8_t index = base / ONEWIRE_MEMORY_ROW;
+			if (!rowFlag(mValid, index) && !fetch(index, 1))
+				return false;
+			if (memcmp(mCache + address, buf, n))
+			{
+				memcpy(mCache + address, buf, n);
+				setRowFlag(mDirty, index, true);
+			}
+		}
+		else
+		{
+			// uncached rows are read, merged and written straight away
+			if (!readMemory(base, row, ONEWIRE_MEMORY_ROW))
+				return false;
+			if (memcmp(row + offset, buf, n))
+			{
+				memcpy(row + offset, buf, n);
+				if (!writeRow(base, row))
+					return false;
+			}
+		}
+
+		address += n;
+		buf += n;
+		count -= n;
+	}
+	return true;
+}
+
+// Copies every dirty row to the device
+bool OneWireMemory::flush()
+{
+	for (uint8_t i = 0; i < ONEWIRE_MEMORY_ROWS; i++)
+	{
+		if (!rowFlag(mDirty, i))
+			continue;
+		if (!writeRow(i * ONEWIRE_MEMORY_ROW, mCache + i * ONEWIRE_MEMORY_ROW))
+			return false;
+		setRowFlag(mDirty, i, false);
+		mBus.preemptPoint();
+	}
+	return true;
+}
+
+// Write Scratchpad, verify with Read Scratchpad, then Copy Scratchpad with the
+// authorization bytes. EEPROM parts hold the strong pullup for the programming time;
+// the DS2423 is NV SRAM with its own copy command and copies at once.
+bool OneWireMemory::writeRow(uint16_t address, const uint8_t *data)
+{
+	uint8_t check[3 + ONEWIRE_MEMORY_ROW];
+	bool nvram = mRom[0] == 0x1D;
+
+	if (!mBus.wireReset())
+		return false;
+	mBus.wireSelect(mRom);
+	mBus.wireWriteByte(WIRE_COMMAND_WRITE_SCRATCH);
+	mBus.wireWriteByte(address & 0xFF);
+	mBus.wireWriteByte(address >> 8);
+	mBus.wireWriteBlock(data, ONEWIRE_MEMORY_ROW);
+
+	if (!mBus.wireReset())
+		return false;
+	mBus.wireSelect(mRom);
+	mBus.wireWriteByte(WIRE_COMMAND_READ_SCRATCH);
+	mBus.wireReadBlock(check, sizeof(check));
+	if (check[0] != (address & 0xFF) || check[1] != (address >> 8) || memcmp(check + 3, data, ONEWIRE_MEMORY_ROW))
+		return false;
+
+	if (!mBus.wireReset())
+		return false;
+	mBus.wireSelect(mRom);
+	mBus.wireWriteByte(nvram ? WIRE_COMMAND_COPY_NVRAM : WIRE_COMMAND_COPY_SCRATCH);
+	mBus.wireWriteBlock(check, 2);
+	mBus.wireWriteByte(check[2], !nvram);
+	if (!nvram)
+		mBus.wireDelay(ONEWIRE_MEMORY_TPROG);
+
+	return mBus.wireReadByte() == 0xAA;
+}
+
+// Read Memory with Counter from the last byte of a page: data byte, 32 bit
+// write cycle counter, 32 zero bits and the inverted CRC16
+bool OneWireMemory::readCounter(uint8_t page, uint32_t *counter)
+{
+	uint8_t buf[14];
+	uint16_t address = page * 32 + 31;
+
+	if (!mBus.wireReset())
+		return false;
+	buf[0] = WIRE_COMMAND_READ_COUNTER;
+	buf[1] = address & 0xFF;
+	buf[2] = address >> 8;
+	mBus.wireSelect(mRom);
+	mBus.wireWriteBlock(buf, 3);
+	mBus.wireReadBlock(buf + 3, 11);
+	if (!OneWire::check_crc16(buf, 12, buf + 12))
+		return false;
+
+	*counter = buf[4] | ((uint32_t)buf[5] << 8) | ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+	return true;
+}
+
+// Checks the device's write cycle counters and drops cached rows of pages written
+// behind our back. Only DS2423 pages 12 and 13 have such counters, and only when the
+// cache reaches them; other pages and parts can only be invalidated explicitly.
+bool OneWireMemory::revalidate()
+{
+	if (mRom[0] != 0x1D)
+		return true;
+
+	for (uint8_t i = 0; i < ONEWIRE_MEMORY_COUNTED; i++)
+	{
+		uint8_t page = ONEWIRE_MEMORY_COUNTED_PAGE + i;
+		uint32_t counter;
+
+		if (page * 32 >= ONEWIRE_MEMORY_CACHE_SIZE)
+			break;
+		if (!readCounter(page, &counter))
+			return false;
+		if ((mCountersValid & (1 << i)) && counter != mCounters[i])
+		{
+			for (uint16_t a = page * 32; a < page * 32 + 32 && a < ONEWIRE_MEMORY_CACHE_SIZE; a += ONEWIRE_MEMORY_ROW)
+			{
+				setRowFlag(mValid, a / ONEWIRE_MEMORY_ROW, false);
+				setRowFlag(mDirty, a / ONEWIRE_MEMORY_ROW, false);
+			}
+		}
+		mCounters[i] = counter;
+		mCountersValid |= 1 << i;
+	}
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef __ONEWIREMEMORY_H__
+#define __ONEWIREMEMORY_H__
+
+#include <inttypes.h>
+#include "DS2482_OneWire.h"
+
+// Bytes of device memory held in RAM per OneWireMemory, from address 0.
+// Accesses above it go to the device directly.
+#ifndef ONEWIRE_MEMORY_CACHE_SIZE
+#define ONEWIRE_MEMORY_CACHE_SIZE	128
+#endif
+
+// Cache and write granularity: one DS2431 scratchpad row
+#define ONEWIRE_MEMORY_ROW			8
+#define ONEWIRE_MEMORY_ROWS			(ONEWIRE_MEMORY_CACHE_SIZE / ONEWIRE_MEMORY_ROW)
+
+#define WIRE_COMMAND_READ_MEMORY	0xF0
+#define WIRE_COMMAND_WRITE_SCRATCH	0x0F
+#define WIRE_COMMAND_READ_SCRATCH	0xAA
+#define WIRE_COMMAND_COPY_SCRATCH	0x55
+#define WIRE_COMMAND_COPY_NVRAM		0x5A	// DS2423 Copy Scratchpad
+#define WIRE_COMMAND_READ_COUNTER	0xA5
+
+// EEPROM programming time in ms
+#define ONEWIRE_MEMORY_TPROG		10
+
+// DS2423 pages with a write cycle counter; pages 14 and 15 count external pulses
+#define ONEWIRE_MEMORY_COUNTED_PAGE	12
+#define ONEWIRE_MEMORY_COUNTED		2
+
+// Page cache for a DS2431/DS2433/DS2423 class memory device. Reads are served from RAM
+// after the first fetch; writes only mark rows dirty and flush() copies the changed
+// 8 byte rows through the scratchpad.
+class OneWireMemory
+{
+public:
+	OneWireMemory(OneWire &bus, const uint8_t rom[8]);
+	uint16_t size();
+	bool read(uint16_t address, uint8_t *buf, uint16_t count);
+	bool write(uint16_t address, const uint8_t *buf, uint16_t count);
+	bool flush();
+	void invalidate();
+	bool revalidate();
+
+private:
+	bool readMemory(uint16_t address, uint8_t *buf, uint16_t count);
+	bool fetch(uint8_t row, uint8_t count);
+	bool writeRow(uint16_t address, const uint8_t *data);
+	bool readCounter(uint8_t page, uint32_t *counter);
+	bool rowFlag(const uint8_t *flags, uint8_t row);
+	void setRowFlag(uint8_t *flags, uint8_t row, bool on);
+
+	OneWire &mBus;
+	uint8_t mRom[8];
+	uint16_t mSize;
+	uint8_t mCache[ONEWIRE_MEMORY_CACHE_SIZE];
+	uint8_t mValid[(ONEWIRE_MEMORY_ROWS + 7) / 8];
+	uint8_t mDirty[(ONEWIRE_MEMORY_ROWS + 7) / 8];
+	uint32_t mCounters[ONEWIRE_MEMORY_COUNTED];
+	uint8_t mCountersValid;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include "OneWireRollup.h"
+
+OneWireRollup::OneWireRollup() : mRomTable(mRoms, mUpdated, ONEWIRE_ROLLUP_ROMS)
+{
+	clear();
+}
+
+void OneWireRollup::clear()
+{
+	mRomTable.clear();
+}
+
+// Period length of a level in ms
+uint32_t OneWireRollup::period(uint8_t level)
+{
+	return level == ONEWIRE_ROLLUP_HOUR ? 3600000UL : 60000UL;
+}
+
+// Mean in raw register units, convert with OneWire::rawToCelsius()
+float OneWireRollup::mean(const OneWireAggregate *aggregate)
+{
+	return aggregate->count ? (float)aggregate->sum / aggregate->count : 0;
+}
+
+// Folds a device's current reading into its aggregates. Meant to be called from the
+// readingHook() of the bus, which only reports CRC checked values.
+bool OneWireRollup::add(const OneWireDevice *device)
+{
+	return add(device->rom, device->raw, millis());
+}
+
+// Readings must arrive in time order per ROM, older ones are dropped
+bool OneWireRollup::add(const uint8_t rom[8], int16_t raw, uint32_t time)
+{
+	uint8_t slot = mRomTable.find(rom);
+
+	if (slot == ONEWIRE_ROLLUP_NONE)
+	{
+		slot = mRomTable.claim(rom);
+		memset(mBuckets[slot], 0, sizeof(mBuckets[slot]));
+	}
+	else if ((int32_t)(time - mUpdated[slot]) < 0)
+		return false;
+	mUpdated[slot] = time;
+
+	for (uint8_t level = 0; level < ONEWIRE_ROLLUP_LEVELS; level++)
+	{
+		uint32_t index = time / period(level);
+		OneWireAggregate *bucket = &mBuckets[slot][level][index % ONEWIRE_ROLLUP_DEPTH];
+		uint32_t start = index * period(level);
+
+		if (!bucket->count || bucket->start != start)
+		{
+			bucket->start = start;
+			bucket->count = 0;
+			bucket->min = raw;
+			bucket->max = raw;
+			bucket->sum = 0;
+		}
+		if (raw < bucket->min)
+			bucket->min = raw;
+		if (raw > bucket->max)
+			bucket->max = raw;
+		bucket->last = raw;
+		if (bucket->count < 0xFFFF)
+		{
+			bucket->sum += raw;
+			bucket->count++;
+		}
+	}
+	return true;
+}
+
+// Aggregate of the period at the given level that contains time. Returns false if that
+// period holds no readings or is no longer kept.
+bool OneWireRollup::get(const uint8_t rom[8], uint8_t level, uint32_t time, OneWireAggregate *out)
+{
+	uint8_t slot = mRomTable.find(rom);
+
+	if (slot == ONEWIRE_ROLLUP_NONE || level >= ONEWIRE_ROLLUP_LEVELS)
+		return false;
+
+	uint32_t index = time / period(level);
+	OneWireAggregate *bucket = &mBuckets[slot][level][index % ONEWIRE_ROLLUP_DEPTH];
+	if (!bucket->count || bucket->start != index * period(level))
+		return false;
+	*out = *bucket;
+	return true;
+}
@@ -0,0 +1,61 @@
+#ifndef __ONEWIREROLLUP_H__
+#define __ONEWIREROLLUP_H__
+
+#include <inttypes.h>
+#include "DS2482_OneWire.h"
+#include "OneWireRomTable.h"
+
+// Distinct ROMs tracked; the least recently updated one gives up its slot. Each costs
+// 16 bytes per bucket, so 2 KB AVR parts such as the ATmega328 track a few by default.
+#ifndef ONEWIRE_ROLLUP_ROMS
+#if defined(RAMEND) && RAMEND < 0x1000
+#define ONEWIRE_ROLLUP_ROMS			4
+#else
+#define ONEWIRE_ROLLUP_ROMS			ONEWIRE_MAX_DEVICES
+#endif
+#endif
+
+// Buckets kept per ROM and level: the current one and the completed ones before it
+#ifndef ONEWIRE_ROLLUP_DEPTH
+#define ONEWIRE_ROLLUP_DEPTH		2
+#endif
+
+// Aggregation levels
+#define ONEWIRE_ROLLUP_MINUTE		0
+#define ONEWIRE_ROLLUP_HOUR			1
+#define ONEWIRE_ROLLUP_LEVELS		2
+
+#define ONEWIRE_ROLLUP_NONE			ONEWIRE_ROM_NONE
+
+// Aggregate of the readings of one ROM within one period, in raw register units
+struct OneWireAggregate
+{
+	uint32_t start;			// start of the period, same time base as add()
+	uint16_t count;			// 0 if the bucket holds no readings
+	int16_t min;
+	int16_t max;
+	int16_t last;
+	int32_t sum;
+};
+
+// Per-minute and per-hour count/min/max/sum/last per ROM, updated on every reading so
+// a lookup is a table access. Periods are aligned to multiples of their length.
+class OneWireRollup
+{
+public:
+	OneWireRollup();
+	void clear();
+	bool add(const OneWireDevice *device);
+	bool add(const uint8_t rom[8], int16_t raw, uint32_t time);
+	bool get(const uint8_t rom[8], uint8_t level, uint32_t time, OneWireAggregate *out);
+	static uint32_t period(uint8_t level);
+	static float mean(const OneWireAggregate *aggregate);
+
+private:
+	uint8_t mRoms[ONEWIRE_ROLLUP_ROMS][8];
+	uint32_t mUpdated[ONEWIRE_ROLLUP_ROMS];		// time of each ROM's last reading
+	OneWireAggregate mBuckets[ONEWIRE_ROLLUP_ROMS][ONEWIRE_ROLLUP_LEVELS][ONEWIRE_ROLLUP_DEPTH];
+	OneWireRomTable mRomTable;
+};
+
+#endif
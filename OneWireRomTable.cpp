@@ -0,0 +1,49 @@
+#include <Arduino.h>
+#include "OneWireRomTable.h"
+
+OneWireRomTable::OneWireRomTable(uint8_t (*roms)[8], const uint32_t *stamps, uint8_t size) : mRoms(roms), mStamps(stamps), mSize(size)
+{
+	clear();
+}
+
+void OneWireRomTable::clear()
+{
+	mCount = 0;
+}
+
+uint8_t OneWireRomTable::count()
+{
+	return mCount;
+}
+
+const uint8_t *OneWireRomTable::get(uint8_t slot)
+{
+	return slot < mCount ? mRoms[slot] : 0;
+}
+
+uint8_t OneWireRomTable::find(const uint8_t rom[8])
+{
+	for (uint8_t i = 0; i < mCount; i++)
+		if (!memcmp(mRoms[i], rom, 8))
+			return i;
+	return ONEWIRE_ROM_NONE;
+}
+
+// Takes a free slot, or the one with the oldest stamp. The caller resets whatever it
+// keeps per slot, including the stamp.
+uint8_t OneWireRomTable::claim(const uint8_t rom[8])
+{
+	uint8_t slot = mCount;
+
+	if (mCount < mSize)
+		mCount++;
+	else
+	{
+		slot = 0;
+		for (uint8_t i = 1; i < mCount; i++)
+			if ((int32_t)(mStamps[i] - mStamps[slot]) < 0)
+				slot = i;
+	}
+	memcpy(mRoms[slot], rom, 8);
+	return slot;
+}
@@ -0,0 +1,29 @@
+#ifndef __ONEWIREROMTABLE_H__
+#define __ONEWIREROMTABLE_H__
+
+#include <inttypes.h>
+
+#define ONEWIRE_ROM_NONE			0xFF
+
+// Fixed table of ROM codes shared by the history and the rollup. The owner keeps the
+// storage and a stamp per slot that grows with use, a time or a sequence number. Once
+// the table is full, a new ROM takes the slot with the oldest stamp; stamps are
+// compared wrap-safe, so millis() may roll over.
+class OneWireRomTable
+{
+public:
+	OneWireRomTable(uint8_t (*roms)[8], const uint32_t *stamps, uint8_t size);
+	void clear();
+	uint8_t count();
+	const uint8_t *get(uint8_t slot);
+	uint8_t find(const uint8_t rom[8]);
+	uint8_t claim(const uint8_t rom[8]);
+
+private:
+	uint8_t (*mRoms)[8];
+	const uint32_t *mStamps;
+	uint8_t mSize;
+	uint8_t mCount;
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include <Arduino.h>
+#include "OneWireScheduler.h"
+
+OneWireScheduler::OneWireScheduler()
+{
+	mCount = 0;
+	mTaskCount = 0;
+	mNextTask = 0;
+	mWindowStart = millis();
+	clearStats();
+}
+
+// Adds a bridge whose registry is acquired every period ms, starting now. Slots are kept
+// sorted by mux path, so one poll() pass serves all bridges behind a mux channel before
+// switching to the next one.
+bool OneWireScheduler::add(OneWire &bridge, uint32_t period)
+{
+	if (mCount >= ONEWIRE_MAX_BRIDGES)
+		return false;
+
+	uint8_t i = mCount++;
+	for (; i > 0 && mSlots[i - 1].bridge->getMuxPath() > bridge.getMuxPath(); i--)
+		mSlots[i] = mSlots[i - 1];
+
+	Slot *slot = &mSlots[i];
+	slot->bridge = &bridge;
+	slot->period = period;
+	slot->retry = 0;
+	slot->next = millis();
+	slot->running = 0;
+	slot->started = 0;
+	slot->busy = 0;
+	slot->misses = 0;
+	return true;
+}
+
+// Adds maintenance work (rescans, memory scrubs, health checks) split into steps that
+// each take at most budget ms. Steps only run in slack time: when no foreground work is
+// due within the budget and the bridge is not in the middle of a transaction.
+bool OneWireScheduler::addTask(OneWire &bridge, OneWireTaskStep step, void *context, uint16_t budget)
+{
+	if (mTaskCount >= ONEWIRE_MAX_TASKS)
+		return false;
+
+	Task *task = &mTasks[mTaskCount++];
+	task->bridge = &bridge;
+	task->step = step;
+	task->context = context;
+	task->budget = budget;
+	return true;
+}
+
+// Background tasks not finished yet
+uint8_t OneWireScheduler::taskCount()
+{
+	return mTaskCount;
+}
+
+// Runs at most one background step, round robin over the tasks that fit in the slack
+void OneWireScheduler::runTask()
+{
+	uint32_t slack = due();
+
+	for (uint8_t n = 0; n < mTaskCount; n++)
+	{
+		uint8_t i = (mNextTask + n) % mTaskCount;
+		Task *task = &mTasks[i];
+
+		// due() saturates at 0xFFFFFFFF when no slot is registered
+		if (slack < 0xFFFFFFFF - ONEWIRE_TASK_DELAY && slack + ONEWIRE_TASK_DELAY < task->budget)
+			continue;
+		if (!task->bridge->busFree() || bridgeTaken(task->bridge))
+			continue;
+
+		unsigned long start = millis();
+		bool more = task->step(*task->bridge, task->context);
+		mStats.taskSteps++;
+		if (millis() - start > task->budget)
+			mStats.taskOverruns++;
+
+		if (more)
+			mNextTask = i + 1;
+		else
+		{
+			mTasks[i] = mTasks[--mTaskCount];
+			mNextTask = i;
+		}
+		return;
+	}
+}
+
+const OneWireSchedulerStats *OneWireScheduler::getStats()
+{
+	return &mStats;
+}
+
+void OneWireScheduler::clearStats()
+{
+	uint8_t shedding = mStats.shedding;
+	memset(&mStats, 0, sizeof(mStats));
+	mStats.shedding = shedding;
+}
+
+// Moves each bridge one shedding level up or down at the end of a window
+void OneWireScheduler::shedLoad()
+{
+	unsigned long window = millis() - mWindowStart;
+
+	if (window < ONEWIRE_SHED_WINDOW)
+		return;
+
+	mStats.shedding = 0;
+	for (uint8_t i = 0; i < mCount; i++)
+	{
+		Slot *slot = &mSlots[i];
+		uint8_t level = slot->bridge->getShedLevel();
+		uint32_t load = slot->busy * 100 / window;
+
+		if ((load >= ONEWIRE_SHED_HIGH || slot->misses >= ONEWIRE_SHED_MISSES) && level < ONEWIRE_SHED_MAX)
+			level++;
+		else if (load < ONEWIRE_SHED_LOW && !slot->misses && level > ONEWIRE_SHED_NONE)
+			level--;
+
+		if (level != slot->bridge->getShedLevel())
+		{
+			slot->bridge->setShedLevel(level);
+			mStats.shedChanges++;
+		}
+		if (level)
+			mStats.shedding++;
+		slot->busy = 0;
+		slot->misses = 0;
+	}
+	mWindowStart = millis();
+}
+
+// Time in ms until a slot needs service
+uint32_t OneWireScheduler::slotDue(Slot *slot, unsigned long now)
+{
+	if (slot->running)
+		return slot->bridge->acquireDue();
+	long wait = (long)(slot->next - now);
+	// a quarantined segment gives its time to the others until its next probe
+	uint32_t probe = slot->bridge->quarantineDue();
+	if ((long)probe > wait)
+		wait = probe;
+	return wait > 0 ? wait : 0;
+}
+
+// True if another slot drives a channel of the same DS2482-800 and is in the middle of
+// a device transaction or holds the strong pullup for a parasite conversion. A channel
+// switch would cut off either.
+bool OneWireScheduler::bridgeTaken(OneWire *bridge)
+{
+	for (uint8_t i = 0; i < mCount; i++)
+	{
+		OneWire *other = mSlots[i].bridge;
+		if (other != bridge && other->getAddress() == bridge->getAddress() &&
+			other->getMuxPath() == bridge->getMuxPath() && (other->acquireBusy() || !other->busFree()))
+			return true;
+	}
+	return false;
+}
+
+// Starts cycles whose time has come and advances running ones. Never waits on a conversion
+// or on the bridges: reads move on by one 1-Wire operation per bridge and pass, so the
+// bridges work in parallel and each pass costs one status read per busy bridge.
+void OneWireScheduler::poll()
+{
+	for (uint8_t i = 0; i < mCount; i++)
+	{
+		Slot *slot = &mSlots[i];
+		unsigned long now = millis();
+
+		if (slotDue(slot, now) || bridgeTaken(slot->bridge))
+			continue;
+
+		if (!slot->running)
+		{
+			// a late start stretches the sample interval past the period
+			if ((long)(now - slot->next) > 0)
+			{
+				mStats.misses++;
+				if (slot->misses < 0xFF)
+					slot->misses++;
+			}
+			slot->running = slot->bridge->acquireStart();
+			if (!slot->running)
+			{
+				slot->next = now + slot->period;
+				continue;
+			}
+			slot->started = now;
+			// the period runs from the intended start, not from when we got to it
+			slot->next += slot->period;
+			if ((long)(slot->next - now) < 0)
+				slot->next = now + slot->period;
+		}
+
+		if (!slot->bridge->acquirePoll())
+			continue;
+
+		slot->running = 0;
+		slot->busy += millis() - slot->started;
+		mStats.cycles++;
+		if (slot->bridge->acquireResult())
+			slot->retry = 0;
+		else if (!slot->bridge->quarantined())
+		{
+			// nothing read: back off instead of hammering a broken segment
+			slot->retry = slot->retry ? slot->retry * 2 : ONEWIRE_RETRY_MIN;
+			if (slot->retry > slot->period)
+				slot->retry = slot->period;
+			slot->next = millis() + slot->retry;
+			mStats.retries++;
+		}
+	}
+	shedLoad();
+	runTask();
+}
+
+// Time in ms until poll() has work to do. A caller can sleep this long, or arm a
+// timer with it, without missing a conversion deadline.
+uint32_t OneWireScheduler::due()
+{
+	unsigned long now = millis();
+	uint32_t wait = 0xFFFFFFFFUL;
+
+	for (uint8_t i = 0; i < mCount; i++)
+	{
+		uint32_t slotWait = slotDue(&mSlots[i], now);
+		if (slotWait < wait)
+			wait = slotWait;
+	}
+	return wait;
+}
@@ -0,0 +1,108 @@
+#ifndef __ONEWIRESCHEDULER_H__
+#define __ONEWIRESCHEDULER_H__
+
+#include <inttypes.h>
+#include "DS2482_OneWire.h"
+
+// Bridges one scheduler can serve
+#ifndef ONEWIRE_MAX_BRIDGES
+#define ONEWIRE_MAX_BRIDGES			8
+#endif
+
+// First retry delay in ms after a cycle without valid readings, doubled up to the period
+#define ONEWIRE_RETRY_MIN			250
+
+// Load shedding: every window the scheduler compares each bridge's share of time spent
+// in acquisition cycles, and its late starts, against these thresholds. One level
+// of ONEWIRE_SHED_* is added when a bridge is overloaded and removed again once it has
+// headroom.
+#ifndef ONEWIRE_SHED_WINDOW
+#define ONEWIRE_SHED_WINDOW			10000	// ms
+#endif
+#ifndef ONEWIRE_SHED_HIGH
+#define ONEWIRE_SHED_HIGH			80		// % utilization that adds a level
+#endif
+#ifndef ONEWIRE_SHED_LOW
+#define ONEWIRE_SHED_LOW			50		// % utilization below which a level is removed
+#endif
+#ifndef ONEWIRE_SHED_MISSES
+#define ONEWIRE_SHED_MISSES			1		// missed deadlines per window that add a level
+#endif
+
+// Background tasks one scheduler can hold
+#ifndef ONEWIRE_MAX_TASKS
+#define ONEWIRE_MAX_TASKS			4
+#endif
+
+// How far in ms a background step may push back foreground work that is already due
+#ifndef ONEWIRE_TASK_DELAY
+#define ONEWIRE_TASK_DELAY			2
+#endif
+
+// One step of a background task: a short piece of work on the bridge that returns true
+// while more steps remain
+typedef bool (*OneWireTaskStep)(OneWire &bridge, void *context);
+
+// Scheduler counters, cleared by clearStats()
+struct OneWireSchedulerStats
+{
+	uint32_t cycles;		// acquisition cycles completed
+	uint32_t misses;		// cycles started after their deadline, by 1 ms or more
+	uint32_t retries;		// cycles rescheduled with backoff after a failure
+	uint16_t shedChanges;	// load shedding level changes on any bridge
+	uint8_t shedding;		// bridges currently shedding load, not cleared
+	uint32_t taskSteps;		// background task steps run
+	uint16_t taskOverruns;	// steps that took longer than their budget
+};
+
+// Runs periodic acquisition on several bridges from one thread without blocking.
+// poll() does whatever work is due and returns; due() tells the caller how long it may
+// sleep, so the scheduler can be driven from loop(), a timer or an event loop.
+class OneWireScheduler
+{
+public:
+	OneWireScheduler();
+	bool add(OneWire &bridge, uint32_t period);
+	bool addTask(OneWire &bridge, OneWireTaskStep step, void *context, uint16_t budget);
+	uint8_t taskCount();
+	void poll();
+	uint32_t due();
+	const OneWireSchedulerStats *getStats();
+	void clearStats();
+
+private:
+	struct Slot
+	{
+		OneWire *bridge;
+		uint32_t period;		// ms between cycle starts
+		uint32_t retry;			// current backoff in ms, 0 when healthy
+		unsigned long next;		// millis() at which the next cycle should start
+		uint8_t running;
+		unsigned long started;	// millis() at which the running cycle started
+		uint32_t busy;			// ms of cycles completed this window, start to finish
+		uint8_t misses;			// cycles started late this window
+	};
+
+	struct Task
+	{
+		OneWire *bridge;
+		OneWireTaskStep step;
+		void *context;
+		uint16_t budget;		// longest a step is expected to take, in ms
+	};
+
+	uint32_t slotDue(Slot *slot, unsigned long now);
+	void runTask();
+	void shedLoad();
+	bool bridgeTaken(OneWire *bridge);
+
+	Slot mSlots[ONEWIRE_MAX_BRIDGES];
+	uint8_t mCount;
+	OneWireSchedulerStats mStats;
+	unsigned long mWindowStart;
+	Task mTasks[ONEWIRE_MAX_TASKS];
+	uint8_t mTaskCount;
+	uint8_t mNextTask;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include <Wire.h>
+#include <DS2482_OneWire.h>
+#include <OneWireBatch.h>
+
+OneWire oneWire;
+OneWireBatch batch(oneWire);
+
+void storeReading(const OneWireDevice *device)
+{
+  batch.add(device);
+}
+
+// Writes the batch as a count byte followed by each column as one raw block
+void sendBatch()
+{
+  const OneWireColumns *columns = batch.columns();
+  uint8_t n = batch.count();
+
+  Serial.write(n);
+  Serial.write((const uint8_t *)columns->time, n * sizeof(columns->time[0]));
+  Serial.write((const uint8_t *)columns->value, n * sizeof(columns->value[0]));
+  Serial.write((const uint8_t *)columns->raw, n * sizeof(columns->raw[0]));
+  Serial.write(columns->device, n);
+  Serial.write(columns->flags, n);
+  batch.clear();
+}
+
+void setup()
+{
+  Serial.begin(115200);
+
+  oneWire.deviceReset();
+  oneWire.wireEnumerate();
+  oneWire.readingHook(storeReading);
+}
+
+void loop()
+{
+  oneWire.acquire();
+
+  // send when another cycle might not fit
+  if (ONEWIRE_BATCH_SIZE - batch.count() < oneWire.getDeviceCount())
+    sendBatch();
+
+  delay(1000);
+}
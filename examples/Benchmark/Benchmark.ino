@@ -0,0 +1,84 @@
+#include <Wire.h>
+#include <DS2482_OneWire.h>
+
+// Times the driver's basic operations on the target board. Cycles are derived from
+// micros() and F_CPU, so short operations are repeated to get past the 4us resolution.
+// Flash use is reported by the IDE at compile time.
+
+OneWire oneWire;
+
+uint8_t rom[8];
+
+void report(const char *name, unsigned long us, unsigned int repeat)
+{
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print((float)us / repeat);
+  Serial.print(" us, ");
+  Serial.print((float)us / repeat * (F_CPU / 1000000UL));
+  Serial.print(" cycles, ");
+  Serial.print((float)oneWire.getStats()->transactions / repeat);
+  Serial.println(" I2C transactions");
+}
+
+void setup()
+{
+  Serial.begin(115200);
+
+  Serial.print("RAM per bridge: ");
+  Serial.print(sizeof(OneWire));
+  Serial.println(" bytes");
+
+  oneWire.deviceReset();
+  oneWire.wireResetSearch();
+  if (oneWire.wireSearch(rom) <= 0)
+    Serial.println("No 1-Wire devices, bus timings will be skipped");
+  oneWire.wireResetSearch();
+}
+
+void loop()
+{
+  unsigned long start;
+  volatile uint8_t crc;
+  uint8_t buf[9];
+
+  oneWire.clearStats();
+  start = micros();
+  for (unsigned int i = 0; i < 1000; i++)
+    crc = OneWire::crc8(rom, 7);
+  report("crc8(7 bytes)", micros() - start, 1000);
+  (void)crc;
+
+  oneWire.clearStats();
+  start = micros();
+  for (unsigned int i = 0; i < 100; i++)
+    oneWire.readStatus();
+  report("readStatus", micros() - start, 100);
+
+  if (rom[0])
+  {
+    oneWire.clearStats();
+    start = micros();
+    for (unsigned int i = 0; i < 10; i++)
+      oneWire.wireReset();
+    report("wireReset", micros() - start, 10);
+
+    oneWire.clearStats();
+    start = micros();
+    for (unsigned int i = 0; i < 10; i++)
+    {
+      oneWire.wireResetSearch();
+      oneWire.wireSearch(buf);
+    }
+    report("wireSearch pass", micros() - start, 10);
+
+    oneWire.clearStats();
+    start = micros();
+    for (unsigned int i = 0; i < 10; i++)
+      oneWire.readScratchpad(rom, buf);
+    report("readScratchpad", micros() - start, 10);
+  }
+
+  Serial.println();
+  delay(10000);
+}
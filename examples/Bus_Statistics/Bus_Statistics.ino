@@ -0,0 +1,92 @@
+#include <Wire.h>
+#include <DS2482_OneWire.h>
+#include <OneWireScheduler.h>
+
+// Two DS2482-100 bridges with AD1/AD0 = 00 and 01, one segment each, sampled every
+// 2 seconds. Every 10 seconds the costs per reading, the deadlines missed and each
+// segment's bus utilization over the window are printed.
+OneWire bus0(0);
+OneWire bus1(1);
+OneWire *segments[] = { &bus0, &bus1 };
+OneWireScheduler scheduler;
+
+#define PERIOD	2000
+#define WINDOW	10000
+
+unsigned long windowStart;
+
+void printSegment(uint8_t index, unsigned long window)
+{
+  OneWire *bus = segments[index];
+  const OneWireStats *stats = bus->getStats();
+
+  Serial.print("segment ");
+  Serial.print(index);
+  Serial.print(bus->getAcquireMode() == ONEWIRE_ACQUIRE_PIPELINED ? " pipelined" : " broadcast");
+  Serial.print(", readings: ");
+  Serial.print(stats->readings);
+  Serial.print(", CRC errors: ");
+  Serial.print(stats->crcErrors);
+  Serial.print(", timeouts: ");
+  Serial.println(stats->timeouts);
+
+  // Share of the window the 1-Wire segment was busy
+  Serial.print("\tbus utilization: ");
+  Serial.print(100.0 * stats->busyTime / 1000 / window);
+  Serial.println("%");
+
+  if (stats->readings)
+  {
+    // Cost per reading: cycle time, I2C transactions and busy polls
+    Serial.print("\tms/reading: ");
+    Serial.print((float)stats->cycleTime / stats->readings);
+    Serial.print(", I2C transactions/reading: ");
+    Serial.print((float)stats->transactions / stats->readings);
+    Serial.print(", busy polls/reading: ");
+    Serial.println((float)stats->polls / stats->readings);
+  }
+  bus->clearStats();
+}
+
+void setup()
+{
+  Serial.begin(115200);
+
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    segments[i]->deviceReset();
+    Serial.print("Devices found on segment ");
+    Serial.print(i);
+    Serial.print(": ");
+    Serial.println(segments[i]->wireEnumerate());
+    scheduler.add(*segments[i], PERIOD);
+  }
+  windowStart = millis();
+}
+
+void loop()
+{
+  scheduler.poll();
+
+  unsigned long window = millis() - windowStart;
+  if (window >= WINDOW)
+  {
+    const OneWireSchedulerStats *stats = scheduler.getStats();
+
+    // A cycle that starts a whole period late has lost a sample
+    Serial.print("cycles: ");
+    Serial.print(stats->cycles);
+    Serial.print(", deadline misses: ");
+    Serial.print(stats->misses);
+    Serial.print(", retries: ");
+    Serial.println(stats->retries);
+    scheduler.clearStats();
+
+    for (uint8_t i = 0; i < 2; i++)
+      printSegment(i, window);
+    windowStart = millis();
+  }
+
+  uint32_t due = scheduler.due();
+  delay(due > 100 ? 100 : due);
+}
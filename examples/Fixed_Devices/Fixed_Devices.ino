@@ -0,0 +1,38 @@
+#include <Wire.h>
+#include <DS2482_OneWire.h>
+
+// ROM codes as printed by Scan_1Wire_Bus. A typo in a digit breaks the CRC and the
+// sketch does not compile.
+constexpr OneWireRom sensors[] PROGMEM = {
+  "28FF4C6A7216030F",
+  "28FF0B1E6C16042C",
+};
+
+OneWire oneWire;
+
+void setup()
+{
+  Serial.begin(115200);
+
+  oneWire.deviceReset();
+  // No search at boot: the registry comes straight from flash
+  oneWire.loadDevices(sensors, ONEWIRE_ROM_COUNT(sensors));
+}
+
+void loop()
+{
+  oneWire.acquire();
+
+  for (uint8_t i = 0; i < oneWire.getDeviceCount(); i++)
+  {
+    OneWireDevice *device = oneWire.getDevice(i);
+    Serial.print(i);
+    Serial.print(": ");
+    if (device->flags & ONEWIRE_DEVICE_VALID)
+      Serial.println(OneWire::rawToCelsius(device->rom[0], device->raw));
+    else
+      Serial.println("no reading");
+  }
+
+  delay(5000);
+}
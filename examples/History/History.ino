@@ -0,0 +1,60 @@
+#include <Wire.h>
+#include <DS2482_OneWire.h>
+#include <OneWireHistory.h>
+#include <OneWireRollup.h>
+
+OneWire oneWire;
+OneWireHistory history;
+OneWireRollup rollup;
+
+void storeReading(const OneWireDevice *device)
+{
+  history.add(device);
+  rollup.add(device);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+
+  oneWire.deviceReset();
+  oneWire.wireEnumerate();
+  oneWire.readingHook(storeReading);
+}
+
+void loop()
+{
+  oneWire.acquire();
+
+  // Readings of the first sensor from the last minute
+  static OneWireRecord records[16];
+  if (oneWire.getDeviceCount())
+  {
+    OneWireDevice *device = oneWire.getDevice(0);
+    uint32_t now = millis();
+    uint16_t n = history.query(device->rom, now > 60000 ? now - 60000 : 0, now, records, 16);
+    Serial.print(n);
+    Serial.print(" readings, last minute:");
+    for (uint16_t i = 0; i < n; i++)
+    {
+      Serial.print(' ');
+      Serial.print(OneWire::rawToCelsius(device->rom[0], records[i].raw));
+    }
+    Serial.println();
+
+    // Aggregate of the current hour, kept up to date on every reading
+    OneWireAggregate hour;
+    if (rollup.get(device->rom, ONEWIRE_ROLLUP_HOUR, now, &hour))
+    {
+      Serial.print("this hour: min ");
+      Serial.print(OneWire::rawToCelsius(device->rom[0], hour.min));
+      Serial.print(" max ");
+      Serial.print(OneWire::rawToCelsius(device->rom[0], hour.max));
+      Serial.print(" mean ");
+      // the raw to Celsius conversion is a plain scale factor
+      Serial.println(OneWireRollup::mean(&hour) * OneWire::rawToCelsius(device->rom[0], 1));
+    }
+  }
+
+  delay(5000);
+}
@@ -30,6 +30,9 @@ void setup()
   Serial.begin(115200);
   Serial.println("DS18B20 search");
   
+  // Answer DallasTemperature's by-index lookups from the last full search
+  // instead of searching the bus again for every index
+  oneWire.searchCache(60000);
   sensors.begin();
   
   DeviceAddress currAddress;
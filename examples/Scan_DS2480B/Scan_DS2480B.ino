@@ -0,0 +1,63 @@
+#include <Wire.h>
+#include <DS2482_OneWire.h>
+#include <DS2480B.h>
+
+// DS2480B serial 1-Wire line driver on the second hardware UART
+DS2480B master(Serial1);
+OneWire oneWire(master);
+
+void printAddress(uint8_t deviceAddress[8])
+{
+  Serial.print("{ ");
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    // zero pad the address if necessary
+    Serial.print("0x");
+    if (deviceAddress[i] < 16) Serial.print("0");
+    Serial.print(deviceAddress[i], HEX);
+    if (i<7) Serial.print(", ");
+    
+  }
+  Serial.print(" }");
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial1.begin(9600);
+}
+
+void loop()
+{
+  Serial.println("Checking for DS2480B...:");
+  if (oneWire.checkPresence())
+  {
+    Serial.println("DS2480B present");
+    
+    Serial.println("\tChecking for 1-Wire devices...");
+    if (oneWire.wireReset())
+    {
+      Serial.println("\tDevices present on 1-Wire bus");
+      
+      uint8_t currAddress[8];
+      
+      Serial.println("\t\tSearching 1-Wire bus...");
+      
+      while (oneWire.wireSearch(currAddress) > 0)
+      {
+        Serial.print("\t\t\tFound device: ");
+        printAddress(currAddress);
+        Serial.println();
+      }
+      
+      oneWire.wireResetSearch();
+      
+    }
+    else
+      Serial.println("\tNo devices on 1-Wire bus");
+  }
+  else
+    Serial.println("No DS2480B present");
+    
+  delay(5000);
+}
@@ -0,0 +1,73 @@
+#include <Wire.h>
+#include <DS2482_OneWire.h>
+#include <OneWireScheduler.h>
+
+// Two DS2482-100 bridges with AD1/AD0 = 00 and 01
+OneWire bus0(0);
+OneWire bus1(1);
+OneWireScheduler scheduler;
+
+void printReadings(OneWire &bus)
+{
+  for (uint8_t i = 0; i < bus.getDeviceCount(); i++)
+  {
+    OneWireDevice *device = bus.getDevice(i);
+    if (!(device->flags & ONEWIRE_DEVICE_VALID))
+      continue;
+    Serial.print(device->rom[7], HEX);
+    Serial.print(": ");
+    Serial.println(OneWire::rawToCelsius(device->rom[0], device->raw));
+  }
+}
+
+// Background task with a single step: check that the bridge still answers. It only runs
+// when the bus has slack, so it never delays a conversion.
+bool checkBridge(OneWire &bus, void *context)
+{
+  if (!bus.checkPresence())
+    Serial.println("bridge not answering");
+  return false;
+}
+
+void setup()
+{
+  Serial.begin(115200);
+
+  bus0.deviceReset();
+  bus1.deviceReset();
+  bus0.wireEnumerate();
+  bus1.wireEnumerate();
+
+  // Under overload the scheduler degrades these first: fewer reads, then 9 bit conversions
+  for (uint8_t i = 0; i < bus1.getDeviceCount(); i++)
+    bus1.getDevice(i)->flags |= ONEWIRE_DEVICE_LOW_PRIORITY;
+
+  scheduler.add(bus0, 2000);
+  scheduler.add(bus1, 5000);
+}
+
+void loop()
+{
+  // Conversions run in the background; poll() only touches the bus when work is due
+  scheduler.poll();
+
+  static unsigned long lastCheck;
+  if (millis() - lastCheck > 60000)
+  {
+    lastCheck = millis();
+    scheduler.addTask(bus0, checkBridge, 0, 2);
+    scheduler.addTask(bus1, checkBridge, 0, 2);
+  }
+
+  static unsigned long lastPrint;
+  if (millis() - lastPrint > 10000)
+  {
+    lastPrint = millis();
+    printReadings(bus0);
+    printReadings(bus1);
+  }
+
+  // Everything else in loop() gets the time until the next deadline
+  uint32_t due = scheduler.due();
+  delay(due > 100 ? 100 : due);
+}